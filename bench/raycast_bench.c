@@ -0,0 +1,982 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "raycast.h"
+#include "raycast_batch.h"
+#include "raycast_bounce.h"
+#include "raycast_cache.h"
+#include "raycast_fixed.h"
+#include "raycast_pool.h"
+#include "raycast_precise.h"
+#include "raycast_visibility.h"
+#include "ray_recording.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    Headless raycasting benchmark
+    -----------------------------
+
+    Casts seeded ray sets against a range of grids and prints one JSON document
+    with rays per second, nanoseconds per tile step, heap allocations per cast
+    and per cast latency percentiles for every scenario. The thread pool casts
+    one more ray set at several thread counts, checked against the single
+    threaded batch, and any difference fails the benchmark. The double precision
+    traversal is compared with raycast_grid() on a small grid and far from the
+    grid origin, reporting how far off the exact ray line both place impacts.
+    Any tile difference other than a float tie fails the benchmark as well, as
+    do queries that accept tile storage of another size than their grid and ray
+    recordings that do not read back what was written
+
+    Usage: raycast_bench [seed] [rays_per_scenario]
+*/
+
+#define DEFAULT_SEED 1
+#define DEFAULT_RAYS_PER_SCENARIO 20000
+#define BATCH_RAYS 256
+#define BOUNCE_SEGMENTS 64
+#define POOL_BATCH_RAYS 4096
+
+// Heap allocations are counted through the linker, see the bench target
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * p_memory, size_t size);
+
+static uint64_t allocation_count = 0;
+
+void * __wrap_malloc(size_t size)
+{
+  allocation_count++;
+  return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size)
+{
+  allocation_count++;
+  return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * p_memory, size_t size)
+{
+  allocation_count++;
+  return __real_realloc(p_memory, size);
+}
+
+typedef enum
+{
+  BENCH_MODE_ENUMERATE,
+  BENCH_MODE_ENUMERATE_FIXED,
+  BENCH_MODE_ENUMERATE_CURSOR,
+  BENCH_MODE_BATCH,
+  BENCH_MODE_FIRST_HIT,
+  BENCH_MODE_FIRST_HIT_CACHED,
+  BENCH_MODE_FIRST_HIT_SEGMENTS,
+  BENCH_MODE_VISIBILITY,
+  BENCH_MODE_VISIBILITY_RAY_FAN
+} EBenchModeType;
+
+typedef enum
+{
+  RAY_SET_RANDOM,
+  RAY_SET_AXIS_ALIGNED,
+  RAY_SET_DIAGONAL,
+  RAY_SET_VERTICAL,
+  RAY_SET_GRAZING
+} ERaySetType;
+
+typedef struct
+{
+  const char * p_name;
+  EBenchModeType mode;
+  ERaySetType ray_set;
+  SVec2i tile_dimensions;
+  SVec2i tiles_on_axis;
+  float ray_length_in_tiles;
+  double solid_tile_density;
+  ETileOccupancyLayoutType layout;
+} SBenchScenario;
+
+static const SBenchScenario scenarios[] = {
+  { "enumerate_short_random",       BENCH_MODE_ENUMERATE,          RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   4.0f,    0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_long_random",        BENCH_MODE_ENUMERATE,          RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_long_axis",          BENCH_MODE_ENUMERATE,          RAY_SET_AXIS_ALIGNED, { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_long_diagonal",      BENCH_MODE_ENUMERATE,          RAY_SET_DIAGONAL,     { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_long_grazing",       BENCH_MODE_ENUMERATE,          RAY_SET_GRAZING,      { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_long_wide_tiles",    BENCH_MODE_ENUMERATE,          RAY_SET_RANDOM,       { 32, 8 },  { 128, 512 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_fixed_short_random", BENCH_MODE_ENUMERATE_FIXED,    RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   4.0f,    0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_fixed_long_random",  BENCH_MODE_ENUMERATE_FIXED,    RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "enumerate_cursor_long_random", BENCH_MODE_ENUMERATE_CURSOR,   RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "batch_short_random",           BENCH_MODE_BATCH,              RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   4.0f,    0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "batch_long_random",            BENCH_MODE_BATCH,              RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   200.0f,  0.0,   TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_sparse_random",      BENCH_MODE_FIRST_HIT,          RAY_SET_RANDOM,       { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.001, TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_dense_random",       BENCH_MODE_FIRST_HIT,          RAY_SET_RANDOM,       { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.05,  TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_axis_row_major",     BENCH_MODE_FIRST_HIT,          RAY_SET_AXIS_ALIGNED, { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_ROW_MAJOR },
+  { "first_hit_axis_tiled",         BENCH_MODE_FIRST_HIT,          RAY_SET_AXIS_ALIGNED, { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_vertical_row_major", BENCH_MODE_FIRST_HIT,          RAY_SET_VERTICAL,     { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_ROW_MAJOR },
+  { "first_hit_vertical_tiled",     BENCH_MODE_FIRST_HIT,          RAY_SET_VERTICAL,     { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_diagonal_row_major", BENCH_MODE_FIRST_HIT,          RAY_SET_DIAGONAL,     { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_ROW_MAJOR },
+  { "first_hit_diagonal_tiled",     BENCH_MODE_FIRST_HIT,          RAY_SET_DIAGONAL,     { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_cached_static",      BENCH_MODE_FIRST_HIT_CACHED,   RAY_SET_RANDOM,       { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.005, TILE_OCCUPANCY_LAYOUT_TILED },
+  { "first_hit_segments_reflect",   BENCH_MODE_FIRST_HIT_SEGMENTS, RAY_SET_RANDOM,       { 4, 4 },   { 4096, 4096 }, 4096.0f, 0.05,  TILE_OCCUPANCY_LAYOUT_TILED },
+  { "visibility_shadowcast",        BENCH_MODE_VISIBILITY,         RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   24.0f,   0.05,  TILE_OCCUPANCY_LAYOUT_TILED },
+  { "visibility_ray_fan",           BENCH_MODE_VISIBILITY_RAY_FAN, RAY_SET_RANDOM,       { 16, 16 }, { 256, 256 },   24.0f,   0.05,  TILE_OCCUPANCY_LAYOUT_TILED }
+};
+
+// Rays the thread pool casts in batches of POOL_BATCH_RAYS, once per thread count
+static const SBenchScenario pool_scenario =
+  { "pool_long_random", BENCH_MODE_BATCH, RAY_SET_RANDOM, { 16, 16 }, { 256, 256 }, 32.0f, 0.0, TILE_OCCUPANCY_LAYOUT_TILED };
+static const int pool_thread_counts[] = { 1, 2, 3, 4, 8 };
+#define POOL_THREAD_COUNT_COUNT ((int)(sizeof(pool_thread_counts) / sizeof(pool_thread_counts[0])))
+
+// Grids the double precision traversal is checked on. The far grid starts a
+// billion pixels out, where floats are only exact to a hundred pixels
+static const SBenchScenario precise_scenarios[] = {
+  { "precise_small_grid",  BENCH_MODE_ENUMERATE, RAY_SET_RANDOM, { 16, 16 },   { 256, 256 },         200.0f, 0.0, TILE_OCCUPANCY_LAYOUT_TILED },
+  { "precise_far_origin",  BENCH_MODE_ENUMERATE, RAY_SET_RANDOM, { 100, 100 }, { 1 << 20, 1 << 20 }, 200.0f, 0.0, TILE_OCCUPANCY_LAYOUT_TILED }
+};
+static const SVec2i precise_grid_origins[] = { { -1000, 250 }, { 1 << 30, 1 << 30 } };
+#define PRECISE_SCENARIO_COUNT ((int)(sizeof(precise_scenarios) / sizeof(precise_scenarios[0])))
+
+// Impact times closer than this are a tie in float. Crossings of a vertical and a
+// horizontal edge may come in either order, and crossings at the very end of the
+// ray may or may not count
+#define PRECISE_FLOAT_TIE_TIME (4.0 * FLT_EPSILON)
+
+typedef struct
+{
+  double float_rays_per_second;
+  double precise_rays_per_second;
+  int float_ties;
+  int tile_sequence_mismatches;
+  double max_float_line_error_px;
+  double max_precise_line_error_px;
+} SPreciseResult;
+
+typedef struct
+{
+  double rays_per_second;
+  double ns_per_step;
+  double steps_per_ray;
+  double allocations_per_cast;
+  double latency_p50_ns;
+  double latency_p99_ns;
+} SBenchResult;
+
+// Own generator, so ray sets are identical on every libc
+static uint64_t random_state;
+
+static uint32_t random_next(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return (uint32_t)(random_state >> 32);
+}
+
+static float random_unit(void)
+{
+  return (random_next() >> 8) * (1.0f / 16777216.0f);
+}
+
+static double now_ns(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static int compare_doubles(const void * p_left, const void * p_right)
+{
+  const double left = *(const double *)p_left;
+  const double right = *(const double *)p_right;
+  return (left > right) - (left < right);
+}
+
+static void generate_rays(const SBenchScenario * p_scenario, const SGrid * p_grid, int ray_count, SVec2f * p_origins, SVec2f * p_vectors)
+{
+  const SVec2i grid_dimensions = raycast_grid_dimensions(p_grid);
+  const float tile_size = 0.5f * (p_grid->tile_dimensions.x + p_grid->tile_dimensions.y);
+  const float length = p_scenario->ray_length_in_tiles * tile_size;
+
+  for (int ray_index = 0; ray_index < ray_count; ray_index++)
+  {
+    p_origins[ray_index] = (SVec2f) {
+      p_grid->origin_bottom_left.x + random_unit() * grid_dimensions.x,
+      p_grid->origin_bottom_left.y + random_unit() * grid_dimensions.y
+    };
+
+    const float sign = (random_next() & 1) ? 1.0f : -1.0f;
+    float angle = random_unit() * 6.2831853f;
+    switch (p_scenario->ray_set)
+    {
+      case RAY_SET_AXIS_ALIGNED:
+        angle = (random_next() & 1) ? 0.0f : 3.1415927f;
+        break;
+      case RAY_SET_VERTICAL:
+        angle = sign * 1.5707964f;
+        break;
+      case RAY_SET_DIAGONAL:
+        angle = 0.7853982f + (random_next() & 3) * 1.5707964f;
+        break;
+      case RAY_SET_GRAZING:
+        // Barely off an axis, so the minor axis crosses an edge only every few hundred tiles
+        angle = (random_next() & 3) * 1.5707964f + sign * 0.003f;
+        break;
+      default:
+        break;
+    }
+
+    p_vectors[ray_index] = (SVec2f) { length * cosf(angle), length * sinf(angle) };
+    if (p_scenario->ray_set == RAY_SET_AXIS_ALIGNED) p_vectors[ray_index].y = 0.0f;
+    if (p_scenario->ray_set == RAY_SET_VERTICAL) p_vectors[ray_index].x = 0.0f;
+  }
+}
+
+static int count_visible_tiles(const SVisibilityMap * p_map)
+{
+  int visible_tiles = 0;
+  for (size_t word = 0; word < (size_t)p_map->words_per_row * p_map->tiles_on_axis.y; word++)
+  {
+    visible_tiles += __builtin_popcountll(p_map->p_words[word]);
+  }
+
+  return visible_tiles;
+}
+
+// The naive visibility the shadowcasting replaces - One ray from the origin to the
+// center of every tile on the square around it, marking tiles until a solid one
+static void cast_visibility_ray_fan
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  float radius,
+  SImpactBuffer * p_impact_buffer,
+  SVisibilityMap * p_map
+)
+{
+  const SVec2i origin_tile = {
+    (int)floorf((origin.x - p_grid->origin_bottom_left.x) / p_grid->tile_dimensions.x),
+    (int)floorf((origin.y - p_grid->origin_bottom_left.y) / p_grid->tile_dimensions.y)
+  };
+  const SVec2i radius_in_tiles = { (int)(radius / p_grid->tile_dimensions.x), (int)(radius / p_grid->tile_dimensions.y) };
+  const int perimeter_tiles = 4 * (radius_in_tiles.x + radius_in_tiles.y);
+
+  p_map->p_words[(size_t)origin_tile.y * p_map->words_per_row + (origin_tile.x >> 6)] |= (uint64_t)1 << (origin_tile.x & 63);
+
+  for (int perimeter_tile = 0; perimeter_tile < perimeter_tiles; perimeter_tile++)
+  {
+    // Walk the square counter clockwise starting at its bottom left corner
+    const int side = perimeter_tile < 2 * radius_in_tiles.x ? 0 :
+      perimeter_tile < 2 * (radius_in_tiles.x + radius_in_tiles.y) ? 1 :
+      perimeter_tile < 2 * (2 * radius_in_tiles.x + radius_in_tiles.y) ? 2 : 3;
+    const int offset = perimeter_tile - (side == 0 ? 0 : side == 1 ? 2 * radius_in_tiles.x :
+      side == 2 ? 2 * (radius_in_tiles.x + radius_in_tiles.y) : 2 * (2 * radius_in_tiles.x + radius_in_tiles.y));
+    const SVec2i target_offset =
+      side == 0 ? (SVec2i) { offset - radius_in_tiles.x, -radius_in_tiles.y } :
+      side == 1 ? (SVec2i) { radius_in_tiles.x, offset - radius_in_tiles.y } :
+      side == 2 ? (SVec2i) { radius_in_tiles.x - offset, radius_in_tiles.y } :
+      (SVec2i) { -radius_in_tiles.x, radius_in_tiles.y - offset };
+    const SVec2f target = {
+      p_grid->origin_bottom_left.x + (origin_tile.x + target_offset.x + 0.5f) * p_grid->tile_dimensions.x,
+      p_grid->origin_bottom_left.y + (origin_tile.y + target_offset.y + 0.5f) * p_grid->tile_dimensions.y
+    };
+
+    raycast_grid(p_grid, origin, (SVec2f) { target.x - origin.x, target.y - origin.y }, p_impact_buffer);
+    for (int impact = 0; impact < p_impact_buffer->count; impact++)
+    {
+      const SVec2i tile = p_impact_buffer->p_impacts[impact].impact_tile;
+      p_map->p_words[(size_t)tile.y * p_map->words_per_row + (tile.x >> 6)] |= (uint64_t)1 << (tile.x & 63);
+      if (tile_occupancy_solid(p_occupancy, tile)) break;
+    }
+  }
+}
+
+static SBenchResult run_scenario(const SBenchScenario * p_scenario, int ray_count)
+{
+  const SGrid grid = { { -1000, 250 }, p_scenario->tile_dimensions, p_scenario->tiles_on_axis };
+
+  SVec2f * const p_origins = malloc(sizeof(SVec2f) * ray_count);
+  SVec2f * const p_vectors = malloc(sizeof(SVec2f) * ray_count);
+  double * const p_latencies = malloc(sizeof(double) * ray_count);
+  generate_rays(p_scenario, &grid, ray_count, p_origins, p_vectors);
+
+  STileOccupancy occupancy;
+  tile_occupancy_create_with_layout(&occupancy, grid.tiles_on_axis, p_scenario->layout);
+  const double solid_tiles = p_scenario->solid_tile_density * grid.tiles_on_axis.x * grid.tiles_on_axis.y;
+  for (double solid_tile = 0.0; solid_tile < solid_tiles; solid_tile++)
+  {
+    const SVec2i tile = { (int)(random_next() % grid.tiles_on_axis.x), (int)(random_next() % grid.tiles_on_axis.y) };
+    tile_occupancy_set(&occupancy, tile, true);
+  }
+
+  // Room for every tile a ray of the scenario can cross
+  const int impacts_per_ray = (int)(2.0f * p_scenario->ray_length_in_tiles * 2.0f) + 8;
+  SImpactInformation * const p_impacts = malloc(sizeof(SImpactInformation) * impacts_per_ray * BATCH_RAYS);
+  SImpactBuffer impact_buffer = { p_impacts, impacts_per_ray, 0 };
+  SFixedImpactInformation * const p_fixed_impacts = malloc(sizeof(SFixedImpactInformation) * impacts_per_ray);
+  SFixedImpactBuffer fixed_impact_buffer = { p_fixed_impacts, impacts_per_ray, 0 };
+
+  // Visibility scenarios cast from the ray origins within the ray length
+  const bool visibility_mode = p_scenario->mode == BENCH_MODE_VISIBILITY || p_scenario->mode == BENCH_MODE_VISIBILITY_RAY_FAN;
+  const float visibility_radius = p_scenario->ray_length_in_tiles * 0.5f * (grid.tile_dimensions.x + grid.tile_dimensions.y);
+  SVisibilityMap visibility_map;
+  visibility_map_create(&visibility_map, grid.tiles_on_axis);
+
+  SRaycastSegment * const p_segments = malloc(sizeof(SRaycastSegment) * BOUNCE_SEGMENTS);
+  SRaycastSegmentBuffer segment_buffer = { p_segments, BOUNCE_SEGMENTS, 0 };
+
+  SRaycastCache cache;
+  raycast_cache_create(&cache, p_scenario->mode == BENCH_MODE_FIRST_HIT_CACHED ? 2 * ray_count : 0);
+
+  // Tile steps per ray, counted untimed up front - The traversal moves one tile per
+  // step, so a first hit takes as many steps as it is tiles away from the origin.
+  // Both visibility modes count the tiles the shadowcasting finds visible, so their
+  // time per step compares directly
+  double total_steps = 0.0;
+  for (int ray_index = 0; ray_index < ray_count; ray_index++)
+  {
+    if (visibility_mode)
+    {
+      visibility_map_clear(&visibility_map);
+      raycast_visibility(&grid, &occupancy, p_origins[ray_index], visibility_radius, &visibility_map);
+      total_steps += count_visible_tiles(&visibility_map);
+      continue;
+    }
+
+    // Reflecting rays count the tile edges every segment crosses up to its end
+    if (p_scenario->mode == BENCH_MODE_FIRST_HIT_SEGMENTS)
+    {
+      raycast_first_hit_segments(&grid, &occupancy, p_origins[ray_index], p_vectors[ray_index], NULL, NULL, &segment_buffer);
+      for (int segment = 0; segment < segment_buffer.count; segment++)
+      {
+        const SRaycastSegment * const p_segment = &p_segments[segment];
+        const float segment_time = p_segment->result == RAYCAST_SUCCESS ? p_segment->impact.impact_time : 1.0f;
+        total_steps += floor(fabs(p_segment->vector.x) * segment_time / grid.tile_dimensions.x) +
+                       floor(fabs(p_segment->vector.y) * segment_time / grid.tile_dimensions.y) + 1.0;
+      }
+      continue;
+    }
+
+    raycast_grid(&grid, p_origins[ray_index], p_vectors[ray_index], &impact_buffer);
+    int steps = impact_buffer.count;
+
+    // Static rays cast from the same place every frame, the first cast fills the cache
+    SImpactInformation hit;
+    if (p_scenario->mode == BENCH_MODE_FIRST_HIT_CACHED)
+      raycast_first_hit_cached(&cache, &grid, &occupancy, p_origins[ray_index], p_vectors[ray_index], &hit);
+
+    if ((p_scenario->mode == BENCH_MODE_FIRST_HIT || p_scenario->mode == BENCH_MODE_FIRST_HIT_CACHED) &&
+        raycast_first_hit(&grid, &occupancy, p_origins[ray_index], p_vectors[ray_index], &hit) == RAYCAST_SUCCESS)
+    {
+      // Tiles are entered once at most, so the hit tile marks the step of the hit
+      steps = 0;
+      while (steps < impact_buffer.count && hit.impact_time > 0.0f &&
+             (p_impacts[steps].impact_tile.x != hit.impact_tile.x || p_impacts[steps].impact_tile.y != hit.impact_tile.y)) steps++;
+      if (hit.impact_time > 0.0f) steps++;
+    }
+    total_steps += steps;
+  }
+
+  float * const p_batch_values = malloc(sizeof(float) * 4 * BATCH_RAYS);
+  int batch_counts[BATCH_RAYS];
+  ERaycastResultType batch_results[BATCH_RAYS];
+  SRayBatchResults batch_results_view = { p_impacts, impacts_per_ray, batch_counts, batch_results };
+
+  const uint64_t allocations_before = allocation_count;
+  volatile int sink = 0;
+
+  // Throughput pass, then a latency pass timing every cast or batch on its own
+  double elapsed_ns = 0.0;
+  for (int pass = 0; pass < 2; pass++)
+  {
+    const double pass_start = now_ns();
+    const int rays_per_cast = p_scenario->mode == BENCH_MODE_BATCH ? BATCH_RAYS : 1;
+
+    for (int first_ray = 0; first_ray < ray_count; first_ray += rays_per_cast)
+    {
+      const double cast_start = pass == 1 ? now_ns() : 0.0;
+      const int cast_rays = ray_count - first_ray < rays_per_cast ? ray_count - first_ray : rays_per_cast;
+
+      if (p_scenario->mode == BENCH_MODE_ENUMERATE)
+      {
+        raycast_grid(&grid, p_origins[first_ray], p_vectors[first_ray], &impact_buffer);
+        sink += impact_buffer.count;
+      }
+      else if (p_scenario->mode == BENCH_MODE_ENUMERATE_FIXED)
+      {
+        const SVec2x origin = { (int32_t)(p_origins[first_ray].x * RAYCAST_FIXED_ONE), (int32_t)(p_origins[first_ray].y * RAYCAST_FIXED_ONE) };
+        const SVec2x vector = { (int32_t)(p_vectors[first_ray].x * RAYCAST_FIXED_ONE), (int32_t)(p_vectors[first_ray].y * RAYCAST_FIXED_ONE) };
+        raycast_grid_fixed(&grid, origin, vector, &fixed_impact_buffer);
+        sink += fixed_impact_buffer.count;
+      }
+      else if (p_scenario->mode == BENCH_MODE_ENUMERATE_CURSOR)
+      {
+        SRaycastCursor cursor;
+        SImpactInformation impact;
+        raycast_begin(&cursor, &grid, p_origins[first_ray], p_vectors[first_ray]);
+        while (raycast_next(&cursor, &impact)) sink++;
+      }
+      else if (visibility_mode)
+      {
+        visibility_map_clear(&visibility_map);
+        if (p_scenario->mode == BENCH_MODE_VISIBILITY)
+          raycast_visibility(&grid, &occupancy, p_origins[first_ray], visibility_radius, &visibility_map);
+        else
+          cast_visibility_ray_fan(&grid, &occupancy, p_origins[first_ray], visibility_radius, &impact_buffer, &visibility_map);
+        sink += (int)visibility_map.p_words[0];
+      }
+      else if (p_scenario->mode == BENCH_MODE_FIRST_HIT)
+      {
+        SImpactInformation hit;
+        sink += raycast_first_hit(&grid, &occupancy, p_origins[first_ray], p_vectors[first_ray], &hit);
+      }
+      else if (p_scenario->mode == BENCH_MODE_FIRST_HIT_CACHED)
+      {
+        SImpactInformation hit;
+        sink += raycast_first_hit_cached(&cache, &grid, &occupancy, p_origins[first_ray], p_vectors[first_ray], &hit);
+      }
+      else if (p_scenario->mode == BENCH_MODE_FIRST_HIT_SEGMENTS)
+      {
+        sink += raycast_first_hit_segments(&grid, &occupancy, p_origins[first_ray], p_vectors[first_ray], NULL, NULL, &segment_buffer);
+      }
+      else
+      {
+        for (int lane = 0; lane < cast_rays; lane++)
+        {
+          p_batch_values[lane] = p_origins[first_ray + lane].x;
+          p_batch_values[BATCH_RAYS + lane] = p_origins[first_ray + lane].y;
+          p_batch_values[2 * BATCH_RAYS + lane] = p_vectors[first_ray + lane].x;
+          p_batch_values[3 * BATCH_RAYS + lane] = p_vectors[first_ray + lane].y;
+        }
+        const SRayBatch batch = {
+          p_batch_values, p_batch_values + BATCH_RAYS, p_batch_values + 2 * BATCH_RAYS, p_batch_values + 3 * BATCH_RAYS, cast_rays
+        };
+        raycast_grid_batch(&grid, &batch, &batch_results_view);
+        sink += batch_counts[0];
+      }
+
+      if (pass == 1)
+      {
+        // Batches report the latency per ray they cast
+        const double cast_latency = (now_ns() - cast_start) / cast_rays;
+        for (int ray = 0; ray < cast_rays; ray++) p_latencies[first_ray + ray] = cast_latency;
+      }
+    }
+
+    if (pass == 0) elapsed_ns = now_ns() - pass_start;
+  }
+
+  const uint64_t allocations = allocation_count - allocations_before;
+  qsort(p_latencies, ray_count, sizeof(double), compare_doubles);
+
+  const SBenchResult result = {
+    ray_count / (elapsed_ns * 1e-9),
+    total_steps > 0.0 ? elapsed_ns / total_steps : 0.0,
+    total_steps / ray_count,
+    (double)allocations / (2.0 * ray_count),
+    p_latencies[ray_count / 2],
+    p_latencies[(int)(ray_count * 0.99)]
+  };
+
+  free(p_batch_values);
+  raycast_cache_destroy(&cache);
+  free(p_segments);
+  visibility_map_destroy(&visibility_map);
+  free(p_fixed_impacts);
+  free(p_impacts);
+  tile_occupancy_destroy(&occupancy);
+  free(p_latencies);
+  free(p_vectors);
+  free(p_origins);
+
+  return result;
+}
+
+// Whether the pool cast every ray of the batch just like the single threaded batch
+static bool pool_results_match
+(
+  const SRayBatchResults * p_pool_results,
+  const SRayBatchResults * p_batch_results,
+  int ray_count
+)
+{
+  for (int ray_index = 0; ray_index < ray_count; ray_index++)
+  {
+    const int impact_count = p_batch_results->p_impact_counts[ray_index];
+    const size_t first_impact = (size_t)ray_index * p_batch_results->impacts_per_ray;
+    const bool ray_matches =
+      p_pool_results->p_results[ray_index] == p_batch_results->p_results[ray_index] &&
+      p_pool_results->p_impact_counts[ray_index] == impact_count &&
+      memcmp(
+        p_pool_results->p_impacts + first_impact,
+        p_batch_results->p_impacts + first_impact,
+        sizeof(SImpactInformation) * impact_count
+      ) == 0;
+    if (!ray_matches) return false;
+  }
+
+  return true;
+}
+
+// Copies rays into the structure of arrays layout of a pool batch
+static SRayBatch load_pool_batch(float * p_values, const SVec2f * p_origins, const SVec2f * p_vectors, int ray_count)
+{
+  for (int lane = 0; lane < ray_count; lane++)
+  {
+    p_values[lane] = p_origins[lane].x;
+    p_values[POOL_BATCH_RAYS + lane] = p_origins[lane].y;
+    p_values[2 * POOL_BATCH_RAYS + lane] = p_vectors[lane].x;
+    p_values[3 * POOL_BATCH_RAYS + lane] = p_vectors[lane].y;
+  }
+
+  return (SRayBatch) { p_values, p_values + POOL_BATCH_RAYS, p_values + 2 * POOL_BATCH_RAYS, p_values + 3 * POOL_BATCH_RAYS, ray_count };
+}
+
+// Casts the pool scenario through a pool of every thread count and compares every
+// slice with the single threaded batch. Returns the rays per second of the batch
+static double run_pool_scaling(int ray_count, double * p_out_rays_per_second, bool * p_out_matches)
+{
+  const SGrid grid = { { -1000, 250 }, pool_scenario.tile_dimensions, pool_scenario.tiles_on_axis };
+
+  SVec2f * const p_origins = malloc(sizeof(SVec2f) * ray_count);
+  SVec2f * const p_vectors = malloc(sizeof(SVec2f) * ray_count);
+  generate_rays(&pool_scenario, &grid, ray_count, p_origins, p_vectors);
+
+  const int impacts_per_ray = (int)(2.0f * pool_scenario.ray_length_in_tiles * 2.0f) + 8;
+  float * const p_batch_values = malloc(sizeof(float) * 4 * POOL_BATCH_RAYS);
+  SImpactInformation * const p_batch_impacts = malloc(sizeof(SImpactInformation) * impacts_per_ray * POOL_BATCH_RAYS);
+  SImpactInformation * const p_pool_impacts = malloc(sizeof(SImpactInformation) * impacts_per_ray * POOL_BATCH_RAYS);
+  int * const p_counts = malloc(sizeof(int) * 2 * POOL_BATCH_RAYS);
+  ERaycastResultType * const p_results = malloc(sizeof(ERaycastResultType) * 2 * POOL_BATCH_RAYS);
+  SRayBatchResults batch_results = { p_batch_impacts, impacts_per_ray, p_counts, p_results };
+  SRayBatchResults pool_results = { p_pool_impacts, impacts_per_ray, p_counts + POOL_BATCH_RAYS, p_results + POOL_BATCH_RAYS };
+
+  // One untimed pass first, so the first thread count does not pay for the cold caches
+  for (int first_ray = 0; first_ray < ray_count; first_ray += POOL_BATCH_RAYS)
+  {
+    const int cast_rays = ray_count - first_ray < POOL_BATCH_RAYS ? ray_count - first_ray : POOL_BATCH_RAYS;
+    const SRayBatch batch = load_pool_batch(p_batch_values, p_origins + first_ray, p_vectors + first_ray, cast_rays);
+    raycast_grid_batch(&grid, &batch, &batch_results);
+    raycast_grid_batch(&grid, &batch, &pool_results);
+  }
+
+  // Every slice is cast by the batch right before the pool, and both casts are
+  // timed on their own, so the batch throughput is measured under the same cache
+  // conditions and the comparison follows the pool cast directly
+  double batch_ns = 0.0;
+  int batch_rays = 0;
+  for (int thread_index = 0; thread_index < POOL_THREAD_COUNT_COUNT; thread_index++)
+  {
+    SRaycastPool pool;
+    if (!raycast_pool_create(&pool, pool_thread_counts[thread_index]))
+    {
+      p_out_rays_per_second[thread_index] = 0.0;
+      p_out_matches[thread_index] = false;
+      continue;
+    }
+
+    double elapsed_ns = 0.0;
+    bool matches = true;
+    for (int first_ray = 0; first_ray < ray_count; first_ray += POOL_BATCH_RAYS)
+    {
+      const int cast_rays = ray_count - first_ray < POOL_BATCH_RAYS ? ray_count - first_ray : POOL_BATCH_RAYS;
+      const SRayBatch batch = load_pool_batch(p_batch_values, p_origins + first_ray, p_vectors + first_ray, cast_rays);
+
+      const double batch_start = now_ns();
+      raycast_grid_batch(&grid, &batch, &batch_results);
+      batch_ns += now_ns() - batch_start;
+      batch_rays += cast_rays;
+
+      const double pool_start = now_ns();
+      raycast_pool_cast_batch(&pool, &grid, &batch, &pool_results);
+      elapsed_ns += now_ns() - pool_start;
+
+      matches = matches && pool_results_match(&pool_results, &batch_results, cast_rays);
+    }
+
+    raycast_pool_destroy(&pool);
+    p_out_rays_per_second[thread_index] = ray_count / (elapsed_ns * 1e-9);
+    p_out_matches[thread_index] = matches;
+  }
+
+  free(p_results);
+  free(p_counts);
+  free(p_pool_impacts);
+  free(p_batch_impacts);
+  free(p_batch_values);
+  free(p_vectors);
+  free(p_origins);
+
+  return batch_rays / (batch_ns * 1e-9);
+}
+
+// Distance of a point from the line through the origin along the vector, in long
+// double so the reference is exact to far below a pixel a billion pixels out
+static double line_distance(SVec2d origin, SVec2d vector, double point_x, double point_y)
+{
+  const long double cross = ((long double)point_x - origin.x) * vector.y - ((long double)point_y - origin.y) * vector.x;
+  return (double)(fabsl(cross) / sqrtl((long double)vector.x * vector.x + (long double)vector.y * vector.y));
+}
+
+// Whether both traversals cross the same tiles apart from float ties. At a corner
+// tie the float traversal cuts the corner through the other tile and rejoins right
+// after, at an end tie one of them still crosses an edge the ray ends on
+static bool same_tiles_but_float_ties
+(
+  const SImpactBuffer * p_impacts,
+  const SPreciseImpactBuffer * p_precise_impacts,
+  bool * p_out_float_tie
+)
+{
+  const int common_count = p_impacts->count < p_precise_impacts->count ? p_impacts->count : p_precise_impacts->count;
+  for (int impact = 0; impact < common_count; impact++)
+  {
+    const SVec2i tile = p_impacts->p_impacts[impact].impact_tile;
+    const SVec2i precise_tile = p_precise_impacts->p_impacts[impact].impact_tile;
+    if (tile.x == precise_tile.x && tile.y == precise_tile.y) continue;
+
+    if (impact + 1 == common_count) return false;
+
+    const SVec2i next_tile = p_impacts->p_impacts[impact + 1].impact_tile;
+    const SVec2i next_precise_tile = p_precise_impacts->p_impacts[impact + 1].impact_tile;
+    const double crossing_gap = p_precise_impacts->p_impacts[impact + 1].impact_time - p_precise_impacts->p_impacts[impact].impact_time;
+    if (next_tile.x != next_precise_tile.x || next_tile.y != next_precise_tile.y || crossing_gap > PRECISE_FLOAT_TIE_TIME) return false;
+
+    *p_out_float_tie = true;
+    impact++;
+  }
+
+  if (p_impacts->count == p_precise_impacts->count) return true;
+  if (abs(p_impacts->count - p_precise_impacts->count) > 1) return false;
+
+  const double extra_impact_time = p_impacts->count > common_count
+    ? p_impacts->p_impacts[common_count].impact_time
+    : p_precise_impacts->p_impacts[common_count].impact_time;
+  if (extra_impact_time < 1.0 - PRECISE_FLOAT_TIE_TIME) return false;
+
+  *p_out_float_tie = true;
+  return true;
+}
+
+// Casts the rays of the scenario through raycast_grid() and raycast_grid_precise()
+// from the same float origins and vectors. Each traversal is timed in a pass of its
+// own, then a third pass compares the tiles both cross and measures how far either
+// places its impacts off the ray
+static SPreciseResult run_precise_check(const SBenchScenario * p_scenario, SVec2i grid_origin, int ray_count)
+{
+  const SGrid grid = { grid_origin, p_scenario->tile_dimensions, p_scenario->tiles_on_axis };
+
+  SVec2f * const p_origins = malloc(sizeof(SVec2f) * ray_count);
+  SVec2f * const p_vectors = malloc(sizeof(SVec2f) * ray_count);
+  generate_rays(p_scenario, &grid, ray_count, p_origins, p_vectors);
+
+  const int impacts_per_ray = (int)(2.0f * p_scenario->ray_length_in_tiles * 2.0f) + 8;
+  SImpactInformation * const p_impacts = malloc(sizeof(SImpactInformation) * impacts_per_ray);
+  SPreciseImpactInformation * const p_precise_impacts = malloc(sizeof(SPreciseImpactInformation) * impacts_per_ray);
+  SImpactBuffer impact_buffer = { p_impacts, impacts_per_ray, 0 };
+  SPreciseImpactBuffer precise_impact_buffer = { p_precise_impacts, impacts_per_ray, 0 };
+
+  SPreciseResult result = { 0.0, 0.0, 0, 0, 0.0, 0.0 };
+  volatile int sink = 0;
+
+  const double float_start = now_ns();
+  for (int ray_index = 0; ray_index < ray_count; ray_index++)
+  {
+    raycast_grid(&grid, p_origins[ray_index], p_vectors[ray_index], &impact_buffer);
+    sink += impact_buffer.count;
+  }
+  result.float_rays_per_second = ray_count / ((now_ns() - float_start) * 1e-9);
+
+  const double precise_start = now_ns();
+  for (int ray_index = 0; ray_index < ray_count; ray_index++)
+  {
+    const SVec2d origin = { p_origins[ray_index].x, p_origins[ray_index].y };
+    const SVec2d vector = { p_vectors[ray_index].x, p_vectors[ray_index].y };
+    raycast_grid_precise(&grid, origin, vector, &precise_impact_buffer);
+    sink += precise_impact_buffer.count;
+  }
+  result.precise_rays_per_second = ray_count / ((now_ns() - precise_start) * 1e-9);
+
+  for (int ray_index = 0; ray_index < ray_count; ray_index++)
+  {
+    const SVec2d origin = { p_origins[ray_index].x, p_origins[ray_index].y };
+    const SVec2d vector = { p_vectors[ray_index].x, p_vectors[ray_index].y };
+    raycast_grid(&grid, p_origins[ray_index], p_vectors[ray_index], &impact_buffer);
+    raycast_grid_precise(&grid, origin, vector, &precise_impact_buffer);
+
+    bool float_tie = false;
+    if (!same_tiles_but_float_ties(&impact_buffer, &precise_impact_buffer, &float_tie)) result.tile_sequence_mismatches++;
+    else if (float_tie) result.float_ties++;
+
+    for (int impact = 0; impact < impact_buffer.count && impact < precise_impact_buffer.count; impact++)
+    {
+      const SVec2f point = p_impacts[impact].impact_point;
+      const SVec2d precise_point = p_precise_impacts[impact].impact_point;
+      const double float_error = line_distance(origin, vector, point.x, point.y);
+      const double precise_error = line_distance(origin, vector, precise_point.x, precise_point.y);
+      if (float_error > result.max_float_line_error_px) result.max_float_line_error_px = float_error;
+      if (precise_error > result.max_precise_line_error_px) result.max_precise_line_error_px = precise_error;
+    }
+  }
+
+  free(p_precise_impacts);
+  free(p_impacts);
+  free(p_vectors);
+  free(p_origins);
+
+  return result;
+}
+
+// Queries handed an occupancy or output map of another size than their grid have
+// to turn it down rather than read or write tiles it does not have
+static bool size_mismatches_rejected(void)
+{
+  const SGrid grid = { { 0, 0 }, { 16, 16 }, { 200, 200 } };
+  const SVec2f origin = { 1600.0f, 1600.0f };
+  STileOccupancy occupancy;
+  STileOccupancy small_occupancy;
+  SVisibilityMap map;
+  SVisibilityMap small_map;
+  STileChunkStore store;
+  STileChunkStore small_store;
+  SImpactInformation hit;
+  tile_occupancy_create(&occupancy, grid.tiles_on_axis);
+  tile_occupancy_create(&small_occupancy, (SVec2i) { 4, 4 });
+  visibility_map_create(&map, grid.tiles_on_axis);
+  visibility_map_create(&small_map, (SVec2i) { 4, 4 });
+  tile_chunk_store_create(&store, grid.tiles_on_axis);
+  tile_chunk_store_create(&small_store, (SVec2i) { 4, 4 });
+
+  const bool rejected =
+    raycast_visibility(&grid, &occupancy, origin, 1600.0f, &small_map) == RAYCAST_OCCUPANCY_MISMATCH &&
+    raycast_visibility(&grid, &small_occupancy, origin, 1600.0f, &map) == RAYCAST_OCCUPANCY_MISMATCH &&
+    raycast_visibility(&grid, &occupancy, origin, 1600.0f, &map) == RAYCAST_SUCCESS &&
+    raycast_first_hit_chunked(&grid, &small_store, origin, (SVec2f) { 800.0f, 0.0f }, &hit) == RAYCAST_OCCUPANCY_MISMATCH &&
+    raycast_first_hit_chunked(&grid, &store, origin, (SVec2f) { 800.0f, 0.0f }, &hit) == RAYCAST_MISS;
+
+  tile_chunk_store_destroy(&small_store);
+  tile_chunk_store_destroy(&store);
+  visibility_map_destroy(&small_map);
+  visibility_map_destroy(&map);
+  tile_occupancy_destroy(&small_occupancy);
+  tile_occupancy_destroy(&occupancy);
+
+  return rejected;
+}
+
+static bool recording_entries_equal(const SRayRecordingEntry * p_left, const SRayRecordingEntry * p_right)
+{
+  if (p_left->type != p_right->type) return false;
+  if (p_left->type == RAY_RECORDING_SET_TILE) return p_left->tile.x == p_right->tile.x && p_left->tile.y == p_right->tile.y && p_left->solid == p_right->solid;
+
+  return
+    p_left->origin.x == p_right->origin.x && p_left->origin.y == p_right->origin.y &&
+    p_left->vector.x == p_right->vector.x && p_left->vector.y == p_right->vector.y &&
+    p_left->impact_capacity == p_right->impact_capacity && p_left->result == p_right->result &&
+    p_left->impact_count == p_right->impact_count && p_left->impact_checksum == p_right->impact_checksum;
+}
+
+// Records a tile change, a first hit against it and an enumeration, and reads them
+// back from the file. An entry asking for more than the largest impact capacity
+// has to read as corrupt, as does a header whose grid has no tiles
+static bool recording_round_trips(void)
+{
+  char path[] = "/tmp/raycast_bench_recording_XXXXXX";
+  const int file = mkstemp(path);
+  if (file < 0) return false;
+  close(file);
+
+  const SGrid grid = { { -40, 20 }, { 16, 8 }, { 30, 20 } };
+  const SVec2f origin = { 10.0f, 90.0f };
+  const SVec2f vector = { 300.0f, 41.0f };
+  STileOccupancy occupancy;
+  SImpactInformation impacts[64];
+  if (!tile_occupancy_create(&occupancy, grid.tiles_on_axis))
+  {
+    remove(path);
+    return false;
+  }
+
+  SRayRecordingEntry entries[4] = {
+    { .type = RAY_RECORDING_SET_TILE, .tile = { 10, 10 }, .solid = true },
+    { .type = RAY_RECORDING_FIRST_HIT, .origin = origin, .vector = vector },
+    { .type = RAY_RECORDING_ENUMERATE, .origin = origin, .vector = vector, .impact_capacity = 64 },
+    { .type = RAY_RECORDING_ENUMERATE, .origin = origin, .vector = vector, .impact_capacity = RAY_RECORDING_MAX_IMPACT_CAPACITY + 1 }
+  };
+  tile_occupancy_set(&occupancy, entries[0].tile, entries[0].solid);
+  const ERaycastResultType first_hit_result = raycast_first_hit(&grid, &occupancy, origin, vector, impacts);
+  ray_recording_set_result(&entries[1], first_hit_result, impacts, first_hit_result == RAYCAST_SUCCESS ? 1 : 0);
+  SImpactBuffer buffer = { impacts, 64, 0 };
+  ray_recording_set_result(&entries[2], raycast_grid(&grid, origin, vector, &buffer), impacts, buffer.count);
+  tile_occupancy_destroy(&occupancy);
+
+  SRayRecordingWriter writer;
+  bool round_trips = ray_recording_writer_open(&writer, path, &grid);
+  if (round_trips)
+  {
+    for (int entry_index = 0; entry_index < 4; entry_index++) ray_recording_write(&writer, &entries[entry_index]);
+    round_trips = ray_recording_writer_close(&writer);
+  }
+
+  SRayRecordingReader reader;
+  round_trips = round_trips && ray_recording_reader_open(&reader, path);
+  if (round_trips)
+  {
+    round_trips =
+      reader.grid.origin_bottom_left.x == grid.origin_bottom_left.x && reader.grid.origin_bottom_left.y == grid.origin_bottom_left.y &&
+      reader.grid.tile_dimensions.x == grid.tile_dimensions.x && reader.grid.tile_dimensions.y == grid.tile_dimensions.y &&
+      reader.grid.tiles_on_axis.x == grid.tiles_on_axis.x && reader.grid.tiles_on_axis.y == grid.tiles_on_axis.y &&
+      first_hit_result == RAYCAST_SUCCESS;
+    for (int entry_index = 0; entry_index < 3; entry_index++)
+    {
+      SRayRecordingEntry entry;
+      round_trips = round_trips && ray_recording_read(&reader, &entry) == RAY_RECORDING_READ_ENTRY && recording_entries_equal(&entry, &entries[entry_index]);
+    }
+    SRayRecordingEntry entry;
+    round_trips = round_trips && ray_recording_read(&reader, &entry) == RAY_RECORDING_READ_CORRUPT;
+    ray_recording_reader_close(&reader);
+  }
+
+  const SGrid empty_grid = { grid.origin_bottom_left, grid.tile_dimensions, { 0, grid.tiles_on_axis.y } };
+  round_trips = round_trips && ray_recording_writer_open(&writer, path, &empty_grid) && ray_recording_writer_close(&writer);
+  if (round_trips && ray_recording_reader_open(&reader, path))
+  {
+    ray_recording_reader_close(&reader);
+    round_trips = false;
+  }
+
+  remove(path);
+  return round_trips;
+}
+
+static const char * mode_name(EBenchModeType mode)
+{
+  switch (mode)
+  {
+    case BENCH_MODE_ENUMERATE_FIXED:
+      return "enumerate_fixed";
+    case BENCH_MODE_ENUMERATE_CURSOR:
+      return "enumerate_cursor";
+    case BENCH_MODE_BATCH:
+      return "batch";
+    case BENCH_MODE_FIRST_HIT:
+      return "first_hit";
+    case BENCH_MODE_FIRST_HIT_CACHED:
+      return "first_hit_cached";
+    case BENCH_MODE_FIRST_HIT_SEGMENTS:
+      return "first_hit_segments";
+    case BENCH_MODE_VISIBILITY:
+      return "visibility";
+    case BENCH_MODE_VISIBILITY_RAY_FAN:
+      return "visibility_ray_fan";
+    default:
+      return "enumerate";
+  }
+}
+
+int main(int argc, char * argv[])
+{
+  const uint64_t seed = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_SEED;
+  const int rays_per_scenario = argc > 2 ? atoi(argv[2]) : DEFAULT_RAYS_PER_SCENARIO;
+  if (rays_per_scenario <= 0)
+  {
+    fprintf(stderr, "Usage: %s [seed] [rays_per_scenario]\n", argv[0]);
+    return -1;
+  }
+
+  printf("{\n");
+  printf("  \"seed\": %llu,\n", (unsigned long long)seed);
+  printf("  \"rays_per_scenario\": %d,\n", rays_per_scenario);
+  printf("  \"batch_kernel\": \"%s\",\n", raycast_batch_kernel_name(raycast_batch_best_kernel()));
+  printf("  \"scenarios\": [\n");
+
+  const int scenario_count = (int)(sizeof(scenarios) / sizeof(scenarios[0]));
+  for (int scenario_index = 0; scenario_index < scenario_count; scenario_index++)
+  {
+    const SBenchScenario * const p_scenario = &scenarios[scenario_index];
+
+    // Every scenario draws from its own seed, so one can be changed without
+    // changing the rays of all the others
+    random_state = (seed + 1) * UINT64_C(0x9E3779B97F4A7C15) + scenario_index;
+    const SBenchResult result = run_scenario(p_scenario, rays_per_scenario);
+
+    printf("    {\n");
+    printf("      \"name\": \"%s\",\n", p_scenario->p_name);
+    printf("      \"mode\": \"%s\",\n", mode_name(p_scenario->mode));
+    printf("      \"tile_dimensions\": [%d, %d],\n", p_scenario->tile_dimensions.x, p_scenario->tile_dimensions.y);
+    printf("      \"tiles_on_axis\": [%d, %d],\n", p_scenario->tiles_on_axis.x, p_scenario->tiles_on_axis.y);
+    printf("      \"solid_tile_density\": %g,\n", p_scenario->solid_tile_density);
+    printf("      \"layout\": \"%s\",\n", p_scenario->layout == TILE_OCCUPANCY_LAYOUT_TILED ? "tiled" : "row_major");
+    printf("      \"rays_per_second\": %.0f,\n", result.rays_per_second);
+    printf("      \"ns_per_step\": %.3f,\n", result.ns_per_step);
+    printf("      \"steps_per_ray\": %.2f,\n", result.steps_per_ray);
+    printf("      \"allocations_per_cast\": %g,\n", result.allocations_per_cast);
+    printf("      \"latency_ns\": { \"p50\": %.1f, \"p99\": %.1f }\n", result.latency_p50_ns, result.latency_p99_ns);
+    printf("    }%s\n", scenario_index + 1 < scenario_count ? "," : "");
+  }
+
+  printf("  ],\n");
+
+  random_state = (seed + 1) * UINT64_C(0x9E3779B97F4A7C15) + scenario_count;
+  double pool_rays_per_second[POOL_THREAD_COUNT_COUNT];
+  bool pool_matches[POOL_THREAD_COUNT_COUNT];
+  const double batch_rays_per_second = run_pool_scaling(rays_per_scenario, pool_rays_per_second, pool_matches);
+
+  bool all_pool_results_match = true;
+  printf("  \"pool\": {\n");
+  printf("    \"name\": \"%s\",\n", pool_scenario.p_name);
+  printf("    \"batch_rays_per_second\": %.0f,\n", batch_rays_per_second);
+  printf("    \"thread_counts\": [\n");
+  for (int thread_index = 0; thread_index < POOL_THREAD_COUNT_COUNT; thread_index++)
+  {
+    all_pool_results_match = all_pool_results_match && pool_matches[thread_index];
+    printf(
+      "      { \"threads\": %d, \"rays_per_second\": %.0f, \"speedup\": %.2f, \"matches_batch\": %s }%s\n",
+      pool_thread_counts[thread_index],
+      pool_rays_per_second[thread_index],
+      pool_rays_per_second[thread_index] / batch_rays_per_second,
+      pool_matches[thread_index] ? "true" : "false",
+      thread_index + 1 < POOL_THREAD_COUNT_COUNT ? "," : ""
+    );
+  }
+  printf("    ]\n");
+  printf("  },\n");
+
+  bool all_precise_tiles_match = true;
+  printf("  \"precise\": [\n");
+  for (int precise_index = 0; precise_index < PRECISE_SCENARIO_COUNT; precise_index++)
+  {
+    const SBenchScenario * const p_scenario = &precise_scenarios[precise_index];
+    random_state = (seed + 1) * UINT64_C(0x9E3779B97F4A7C15) + scenario_count + 1 + precise_index;
+    const SPreciseResult result = run_precise_check(p_scenario, precise_grid_origins[precise_index], rays_per_scenario);
+    all_precise_tiles_match = all_precise_tiles_match && result.tile_sequence_mismatches == 0;
+
+    printf("    {\n");
+    printf("      \"name\": \"%s\",\n", p_scenario->p_name);
+    printf("      \"grid_origin\": [%d, %d],\n", precise_grid_origins[precise_index].x, precise_grid_origins[precise_index].y);
+    printf("      \"tile_dimensions\": [%d, %d],\n", p_scenario->tile_dimensions.x, p_scenario->tile_dimensions.y);
+    printf("      \"tiles_on_axis\": [%d, %d],\n", p_scenario->tiles_on_axis.x, p_scenario->tiles_on_axis.y);
+    printf("      \"float_rays_per_second\": %.0f,\n", result.float_rays_per_second);
+    printf("      \"precise_rays_per_second\": %.0f,\n", result.precise_rays_per_second);
+    printf("      \"float_ties\": %d,\n", result.float_ties);
+    printf("      \"tile_sequence_mismatches\": %d,\n", result.tile_sequence_mismatches);
+    printf("      \"max_float_line_error_px\": %.3g,\n", result.max_float_line_error_px);
+    printf("      \"max_precise_line_error_px\": %.3g\n", result.max_precise_line_error_px);
+    printf("    }%s\n", precise_index + 1 < PRECISE_SCENARIO_COUNT ? "," : "");
+  }
+  printf("  ],\n");
+
+  const bool mismatches_rejected = size_mismatches_rejected();
+  const bool recording_checked = recording_round_trips();
+  printf("  \"size_mismatches_rejected\": %s,\n", mismatches_rejected ? "true" : "false");
+  printf("  \"recording_round_trips\": %s\n", recording_checked ? "true" : "false");
+  printf("}\n");
+
+  return all_pool_results_match && all_precise_tiles_match && mismatches_rejected && recording_checked ? 0 : 1;
+}
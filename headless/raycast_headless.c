@@ -0,0 +1,384 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "raycast.h"
+#include "framebuffer.h"
+#include "profile.h"
+#include "ray_recording.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/*
+    Headless frame renderer
+    -----------------------
+
+    Renders the grid, rays and impacts the way the demo does into a software
+    framebuffer and writes every frame as a PPM image, without a window or GL.
+    Each line of the scenario script is one frame:
+
+      origin_x origin_y destination_x destination_y [fan_ray_count]
+
+    in screen coordinates with the origin at the bottom left. A fan casts that many
+    more rays of the same length evenly around the origin. Lines of the form
+
+      solid tile_x tile_y
+      empty tile_x tile_y
+
+    change a tile before the next frame. Once any tile was made solid, the main
+    ray of every frame also stops at the first solid tile it enters, drawn as a
+    yellow point. Empty lines and lines starting with # are skipped. Without a script the ray sweeps once around the
+    center of the screen. Profiling builds also write trace.json, the Chrome trace
+    of the last frames, to the output directory. Given a recording path, every ray
+    cast is also recorded there along with its result, as is every tile change,
+    for raycast_replay
+
+    Usage: raycast_headless output_directory [scenario_script [recording]]
+*/
+
+#define SCREEN_WIDTH 800
+#define SCREEN_HEIGHT 600
+#define TILE_SIZE 20
+#define SWEEP_FRAME_COUNT 360
+#define MAX_RAYCAST_IMPACTS 512
+#define MAX_PATH_LENGTH 1024
+
+typedef struct
+{
+  SVec2f origin;
+  SVec2f destination;
+  int fan_ray_count;
+} SFrameScript;
+
+static SImpactInformation impact_storage[MAX_RAYCAST_IMPACTS];
+
+static double now_ns(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static SPixelColor pixel_color(float r, float g, float b)
+{
+  return (SPixelColor) { (uint8_t)(r * 255.0f + 0.5f), (uint8_t)(g * 255.0f + 0.5f), (uint8_t)(b * 255.0f + 0.5f) };
+}
+
+// Impacts from lowest to highest impact time in ranging color, as in the demo
+static void render_impacts(SFramebuffer * p_framebuffer, const SGrid * p_grid, const SImpactBuffer * p_impacts)
+{
+  const float color_index_step_increment = 1.0f / (float)p_impacts->count;
+  for (int impact_index = 0; impact_index < p_impacts->count; impact_index++)
+  {
+    const SImpactInformation * const p_impact = &p_impacts->p_impacts[impact_index];
+
+    const float time_color = 1.0f - color_index_step_increment * impact_index;
+    const float tile_min_x = p_grid->origin_bottom_left.x + p_impact->impact_tile.x * p_grid->tile_dimensions.x;
+    const float tile_min_y = p_grid->origin_bottom_left.y + p_impact->impact_tile.y * p_grid->tile_dimensions.y;
+    framebuffer_fill_rect(
+      p_framebuffer,
+      tile_min_x,
+      tile_min_y,
+      tile_min_x + p_grid->tile_dimensions.x,
+      tile_min_y + p_grid->tile_dimensions.y,
+      pixel_color(time_color, time_color, time_color)
+    );
+  }
+
+  // Points after all tiles, so the tiles of later impacts cannot cover them
+  for (int impact_index = 0; impact_index < p_impacts->count; impact_index++)
+  {
+    const SVec2f point = p_impacts->p_impacts[impact_index].impact_point;
+    framebuffer_point(p_framebuffer, point.x, point.y, 6.0f, pixel_color(0.0f, 1.0f, 0.0f));
+  }
+}
+
+static void render_grid(SFramebuffer * p_framebuffer, const SGrid * p_grid)
+{
+  const SVec2i grid_dimensions = raycast_grid_dimensions(p_grid);
+  const SAABB4f bounding_box = raycast_grid_bounding_box(p_grid);
+  const SPixelColor grid_line_color = pixel_color(0.25f, 0.25f, 0.25f);
+  const SPixelColor grid_border_color = pixel_color(0.0f, 0.75f, 0.0f);
+
+  for (int line_index = 0; line_index <= p_grid->tiles_on_axis.y; line_index++)
+  {
+    const float line_y = p_grid->origin_bottom_left.y + line_index * p_grid->tile_dimensions.y;
+    framebuffer_line(p_framebuffer, p_grid->origin_bottom_left.x, line_y, p_grid->origin_bottom_left.x + grid_dimensions.x, line_y, 1.0f, grid_line_color);
+  }
+  for (int line_index = 0; line_index <= p_grid->tiles_on_axis.x; line_index++)
+  {
+    const float line_x = p_grid->origin_bottom_left.x + line_index * p_grid->tile_dimensions.x;
+    framebuffer_line(p_framebuffer, line_x, p_grid->origin_bottom_left.y, line_x, p_grid->origin_bottom_left.y + grid_dimensions.y, 1.0f, grid_line_color);
+  }
+
+  framebuffer_line(p_framebuffer, bounding_box.min.x, bounding_box.min.y, bounding_box.max.x, bounding_box.min.y, 1.0f, grid_border_color);
+  framebuffer_line(p_framebuffer, bounding_box.max.x, bounding_box.min.y, bounding_box.max.x, bounding_box.max.y, 1.0f, grid_border_color);
+  framebuffer_line(p_framebuffer, bounding_box.max.x, bounding_box.max.y, bounding_box.min.x, bounding_box.max.y, 1.0f, grid_border_color);
+  framebuffer_line(p_framebuffer, bounding_box.min.x, bounding_box.max.y, bounding_box.min.x, bounding_box.min.y, 1.0f, grid_border_color);
+}
+
+// Casts into the impact buffer and records the ray when there is a recording
+static void cast_ray(const SGrid * p_grid, SVec2f origin, SVec2f vector, SImpactBuffer * p_impacts, SRayRecordingWriter * p_recording)
+{
+  const ERaycastResultType result = raycast_grid(p_grid, origin, vector, p_impacts);
+  if (p_recording == NULL) return;
+
+  SRayRecordingEntry entry = { .type = RAY_RECORDING_ENUMERATE, .origin = origin, .vector = vector, .impact_capacity = (uint32_t)p_impacts->capacity };
+  ray_recording_set_result(&entry, result, p_impacts->p_impacts, p_impacts->count);
+  ray_recording_write(p_recording, &entry);
+}
+
+// Stops at the first solid tile and records the ray when there is a recording.
+// Returns whether a solid tile was hit
+static bool cast_first_hit
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit,
+  SRayRecordingWriter * p_recording
+)
+{
+  const ERaycastResultType result = raycast_first_hit(p_grid, p_occupancy, origin, vector, p_out_hit);
+  const int impact_count = result == RAYCAST_SUCCESS ? 1 : 0;
+  if (p_recording != NULL)
+  {
+    SRayRecordingEntry entry = { .type = RAY_RECORDING_FIRST_HIT, .origin = origin, .vector = vector };
+    ray_recording_set_result(&entry, result, p_out_hit, impact_count);
+    ray_recording_write(p_recording, &entry);
+  }
+
+  return impact_count == 1;
+}
+
+// Changes a tile and records the change when there is a recording
+static void set_tile(STileOccupancy * p_occupancy, SVec2i tile, bool solid, SRayRecordingWriter * p_recording)
+{
+  tile_occupancy_set(p_occupancy, tile, solid);
+  if (p_recording == NULL) return;
+
+  const SRayRecordingEntry entry = { .type = RAY_RECORDING_SET_TILE, .tile = tile, .solid = solid };
+  ray_recording_write(p_recording, &entry);
+}
+
+static void render_solid_tiles(SFramebuffer * p_framebuffer, const SGrid * p_grid, const STileOccupancy * p_occupancy)
+{
+  const SPixelColor solid_color = pixel_color(0.45f, 0.3f, 0.15f);
+  for (int tile_y = 0; tile_y < p_grid->tiles_on_axis.y; tile_y++)
+  {
+    for (int tile_x = 0; tile_x < p_grid->tiles_on_axis.x; tile_x++)
+    {
+      if (!tile_occupancy_solid(p_occupancy, (SVec2i) { tile_x, tile_y })) continue;
+
+      const float tile_min_x = p_grid->origin_bottom_left.x + tile_x * p_grid->tile_dimensions.x;
+      const float tile_min_y = p_grid->origin_bottom_left.y + tile_y * p_grid->tile_dimensions.y;
+      framebuffer_fill_rect(p_framebuffer, tile_min_x, tile_min_y, tile_min_x + p_grid->tile_dimensions.x, tile_min_y + p_grid->tile_dimensions.y, solid_color);
+    }
+  }
+}
+
+static void render_frame
+(
+  SFramebuffer * p_framebuffer,
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  const SFrameScript * p_frame,
+  SRayRecordingWriter * p_recording
+)
+{
+  PROFILE_ZONE("render_frame");
+  SImpactBuffer impacts = { impact_storage, MAX_RAYCAST_IMPACTS, 0 };
+  const SVec2f vector = { p_frame->destination.x - p_frame->origin.x, p_frame->destination.y - p_frame->origin.y };
+  const SPixelColor ray_color = pixel_color(1.0f, 0.0f, 0.0f);
+
+  framebuffer_clear(p_framebuffer, pixel_color(0.2f, 0.2f, 0.2f));
+
+  // Fan rays below the main ray, every one through the same impact buffer
+  const float ray_length = sqrtf(vector.x * vector.x + vector.y * vector.y);
+  for (int fan_ray_index = 0; fan_ray_index < p_frame->fan_ray_count; fan_ray_index++)
+  {
+    const float angle = 6.28318530718f * (float)fan_ray_index / (float)p_frame->fan_ray_count;
+    const SVec2f fan_vector = { cosf(angle) * ray_length, sinf(angle) * ray_length };
+
+    cast_ray(p_grid, p_frame->origin, fan_vector, &impacts, p_recording);
+    render_impacts(p_framebuffer, p_grid, &impacts);
+  }
+
+  cast_ray(p_grid, p_frame->origin, vector, &impacts, p_recording);
+  render_impacts(p_framebuffer, p_grid, &impacts);
+
+  render_solid_tiles(p_framebuffer, p_grid, p_occupancy);
+  render_grid(p_framebuffer, p_grid);
+
+  framebuffer_line(p_framebuffer, p_frame->origin.x, p_frame->origin.y, p_frame->destination.x, p_frame->destination.y, 2.0f, ray_color);
+  framebuffer_point(p_framebuffer, p_frame->origin.x, p_frame->origin.y, 12.0f, ray_color);
+
+  // Every change of a tile counts up the version, so this skips scripts without walls
+  SImpactInformation hit;
+  if (p_occupancy->version != 0 && cast_first_hit(p_grid, p_occupancy, p_frame->origin, vector, &hit, p_recording))
+  {
+    framebuffer_point(p_framebuffer, hit.impact_point.x, hit.impact_point.y, 10.0f, pixel_color(1.0f, 1.0f, 0.0f));
+  }
+}
+
+// Reads the next frame of the script, applying the tile changes before it. Returns
+// false at the end of the script
+static bool read_script_frame
+(
+  FILE * p_script,
+  SFrameScript * p_frame,
+  int * p_line_number,
+  STileOccupancy * p_occupancy,
+  SRayRecordingWriter * p_recording
+)
+{
+  char line[256];
+  while (fgets(line, sizeof(line), p_script) != NULL)
+  {
+    (*p_line_number)++;
+
+    *p_frame = (SFrameScript) { { 0.0f, 0.0f }, { 0.0f, 0.0f }, 0 };
+    char first_character = '\0';
+    if (sscanf(line, " %c", &first_character) != 1 || first_character == '#') continue;
+
+    char tile_state[8];
+    SVec2i tile;
+    if (sscanf(line, " %7s %d %d", tile_state, &tile.x, &tile.y) == 3 && (strcmp(tile_state, "solid") == 0 || strcmp(tile_state, "empty") == 0))
+    {
+      set_tile(p_occupancy, tile, tile_state[0] == 's', p_recording);
+      continue;
+    }
+
+    const int values_read = sscanf(
+      line,
+      "%f %f %f %f %d",
+      &p_frame->origin.x,
+      &p_frame->origin.y,
+      &p_frame->destination.x,
+      &p_frame->destination.y,
+      &p_frame->fan_ray_count
+    );
+    if (values_read < 4 || p_frame->fan_ray_count < 0)
+    {
+      fprintf(stderr, "Skipping malformed scenario line %d\n", *p_line_number);
+      continue;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+int main(int argc, char * argv[])
+{
+  if (argc < 2 || argc > 4)
+  {
+    fprintf(stderr, "Usage: %s output_directory [scenario_script [recording]]\n", argv[0]);
+    return -1;
+  }
+
+  FILE * const p_script = argc >= 3 ? fopen(argv[2], "r") : NULL;
+  if (argc >= 3 && p_script == NULL)
+  {
+    fprintf(stderr, "Could not open scenario script %s\n", argv[2]);
+    return -1;
+  }
+
+  SFramebuffer framebuffer;
+  if (!framebuffer_create(&framebuffer, SCREEN_WIDTH, SCREEN_HEIGHT))
+  {
+    fprintf(stderr, "Could not allocate the framebuffer\n");
+    if (p_script != NULL) fclose(p_script);
+    return -1;
+  }
+
+  // Same grid the demo sets up by default, filling the screen
+  const SGrid grid = { { 0, 0 }, { TILE_SIZE, TILE_SIZE }, { SCREEN_WIDTH / TILE_SIZE, SCREEN_HEIGHT / TILE_SIZE } };
+  const SVec2f screen_center = { SCREEN_WIDTH * 0.5f, SCREEN_HEIGHT * 0.5f };
+
+  STileOccupancy occupancy;
+  if (!tile_occupancy_create(&occupancy, grid.tiles_on_axis))
+  {
+    fprintf(stderr, "Could not allocate the tile occupancy\n");
+    framebuffer_destroy(&framebuffer);
+    if (p_script != NULL) fclose(p_script);
+    return -1;
+  }
+
+  SRayRecordingWriter recording;
+  SRayRecordingWriter * const p_recording = argc == 4 ? &recording : NULL;
+  if (p_recording != NULL && !ray_recording_writer_open(p_recording, argv[3], &grid))
+  {
+    fprintf(stderr, "Could not create recording %s\n", argv[3]);
+    tile_occupancy_destroy(&occupancy);
+    framebuffer_destroy(&framebuffer);
+    fclose(p_script);
+    return -1;
+  }
+
+  profile_set_enabled(true);
+  const double start_ns = now_ns();
+  int frame_count = 0;
+  int line_number = 0;
+  bool written = true;
+  for (;;)
+  {
+    SFrameScript frame;
+    if (p_script != NULL)
+    {
+      if (!read_script_frame(p_script, &frame, &line_number, &occupancy, p_recording)) break;
+    }
+    else
+    {
+      if (frame_count == SWEEP_FRAME_COUNT) break;
+
+      const float angle = 6.28318530718f * (float)frame_count / (float)SWEEP_FRAME_COUNT;
+      frame = (SFrameScript) {
+        screen_center,
+        { screen_center.x + cosf(angle) * SCREEN_HEIGHT * 0.45f, screen_center.y + sinf(angle) * SCREEN_HEIGHT * 0.45f },
+        0
+      };
+    }
+
+    render_frame(&framebuffer, &grid, &occupancy, &frame, p_recording);
+
+    char path[MAX_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/frame_%05d.ppm", argv[1], frame_count);
+    {
+      PROFILE_ZONE("write_ppm");
+      written = framebuffer_write_ppm(&framebuffer, path);
+    }
+    if (!written)
+    {
+      fprintf(stderr, "Could not write %s\n", path);
+      break;
+    }
+    profile_sample_counters();
+
+    frame_count++;
+  }
+
+  const double elapsed_seconds = (now_ns() - start_ns) * 1e-9;
+  printf("Wrote %d frames to %s in %.3f s (%.1f frames per second)\n", frame_count, argv[1], elapsed_seconds, frame_count / elapsed_seconds);
+
+#ifdef RAYCAST_PROFILE
+  char trace_path[MAX_PATH_LENGTH];
+  snprintf(trace_path, sizeof(trace_path), "%s/trace.json", argv[1]);
+  if (!profile_write_chrome_trace(trace_path)) fprintf(stderr, "Could not write %s\n", trace_path);
+#endif
+
+  if (p_recording != NULL && !ray_recording_writer_close(p_recording))
+  {
+    fprintf(stderr, "Could not write recording %s\n", argv[3]);
+    written = false;
+  }
+
+  tile_occupancy_destroy(&occupancy);
+  framebuffer_destroy(&framebuffer);
+  if (p_script != NULL) fclose(p_script);
+
+  return written ? 0 : -1;
+}
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "raycast.h"
+#include "ray_recording.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+    Recorded workload replay
+    ------------------------
+
+    Loads a ray recording made by the demo or the headless renderer and casts
+    every ray of it again against the recorded grid and tile changes. The first
+    pass compares each result with the one recorded, the timed passes after it
+    cast as fast as possible. Prints one JSON document with the throughput and
+    the number of mismatches, and fails when any result drifted
+
+    Usage: raycast_replay recording [repeat_count]
+*/
+
+#define DEFAULT_REPEAT_COUNT 1
+#define MAX_REPORTED_MISMATCHES 8
+
+typedef struct
+{
+  SRayRecordingEntry * p_entries;
+  int capacity;
+  int count;
+} SEntryList;
+
+static double now_ns(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// Reads the whole recording up front, so the replay does not time the file
+static bool load_entries(SRayRecordingReader * p_reader, SEntryList * p_list)
+{
+  for (;;)
+  {
+    SRayRecordingEntry entry;
+    const ERayRecordingReadType read = ray_recording_read(p_reader, &entry);
+    if (read == RAY_RECORDING_READ_END) return true;
+    if (read == RAY_RECORDING_READ_CORRUPT) return false;
+
+    if (p_list->count == p_list->capacity)
+    {
+      const int capacity = p_list->capacity > 0 ? p_list->capacity * 2 : 4096;
+      SRayRecordingEntry * const p_entries = realloc(p_list->p_entries, sizeof(SRayRecordingEntry) * capacity);
+      if (p_entries == NULL) return false;
+
+      p_list->p_entries = p_entries;
+      p_list->capacity = capacity;
+    }
+    p_list->p_entries[p_list->count++] = entry;
+  }
+}
+
+typedef struct
+{
+  const SGrid * p_grid;
+  // NULL for recordings without tile changes and first hits
+  STileOccupancy * p_occupancy;
+  SImpactInformation * p_impacts;
+  uint64_t rays;
+  uint64_t impacts;
+  uint64_t mismatches;
+} SReplayState;
+
+// Casts every ray of the recording once, applying the tile changes in between,
+// and compares the results with the recorded ones when asked to
+static void replay_entries(SReplayState * p_state, const SEntryList * p_entries, bool verify)
+{
+  if (p_state->p_occupancy != NULL) tile_occupancy_clear(p_state->p_occupancy);
+
+  for (int entry_index = 0; entry_index < p_entries->count; entry_index++)
+  {
+    const SRayRecordingEntry * const p_entry = &p_entries->p_entries[entry_index];
+
+    ERaycastResultType result;
+    int impact_count = 0;
+    switch (p_entry->type)
+    {
+      case RAY_RECORDING_SET_TILE:
+        tile_occupancy_set(p_state->p_occupancy, p_entry->tile, p_entry->solid);
+        continue;
+
+      case RAY_RECORDING_FIRST_HIT:
+        result = raycast_first_hit(p_state->p_grid, p_state->p_occupancy, p_entry->origin, p_entry->vector, p_state->p_impacts);
+        impact_count = result == RAYCAST_SUCCESS ? 1 : 0;
+        break;
+
+      default:
+      {
+        SImpactBuffer buffer = { p_state->p_impacts, (int)p_entry->impact_capacity, 0 };
+        result = raycast_grid(p_state->p_grid, p_entry->origin, p_entry->vector, &buffer);
+        impact_count = buffer.count;
+        break;
+      }
+    }
+
+    p_state->rays++;
+    p_state->impacts += impact_count;
+    if (!verify) continue;
+
+    const bool matches =
+      result == p_entry->result &&
+      (uint32_t)impact_count == p_entry->impact_count &&
+      ray_recording_checksum(p_state->p_impacts, impact_count) == p_entry->impact_checksum;
+    if (!matches && p_state->mismatches++ < MAX_REPORTED_MISMATCHES)
+    {
+      fprintf(
+        stderr,
+        "Entry %d drifted: origin (%.9g, %.9g) vector (%.9g, %.9g), result %d with %d impacts, recorded %d with %u\n",
+        entry_index,
+        p_entry->origin.x,
+        p_entry->origin.y,
+        p_entry->vector.x,
+        p_entry->vector.y,
+        (int)result,
+        impact_count,
+        (int)p_entry->result,
+        p_entry->impact_count
+      );
+    }
+  }
+}
+
+int main(int argc, char * argv[])
+{
+  const int repeat_count = argc > 2 ? atoi(argv[2]) : DEFAULT_REPEAT_COUNT;
+  if ((argc != 2 && argc != 3) || repeat_count <= 0)
+  {
+    fprintf(stderr, "Usage: %s recording [repeat_count]\n", argv[0]);
+    return -1;
+  }
+
+  SRayRecordingReader reader;
+  if (!ray_recording_reader_open(&reader, argv[1]))
+  {
+    fprintf(stderr, "%s is no ray recording\n", argv[1]);
+    return -1;
+  }
+
+  SEntryList entries = { NULL, 0, 0 };
+  const bool loaded = load_entries(&reader, &entries);
+  const SGrid grid = reader.grid;
+  ray_recording_reader_close(&reader);
+  if (!loaded)
+  {
+    fprintf(stderr, "%s is truncated or corrupt after %d entries\n", argv[1], entries.count);
+    free(entries.p_entries);
+    return -1;
+  }
+
+  // One buffer large enough for every ray, each ray only gets the capacity it was
+  // recorded with. Only tile changes and first hits need an occupancy
+  uint32_t max_impact_capacity = 1;
+  bool needs_occupancy = false;
+  for (int entry_index = 0; entry_index < entries.count; entry_index++)
+  {
+    const SRayRecordingEntry * const p_entry = &entries.p_entries[entry_index];
+    if (p_entry->impact_capacity > max_impact_capacity) max_impact_capacity = p_entry->impact_capacity;
+    needs_occupancy = needs_occupancy || p_entry->type != RAY_RECORDING_ENUMERATE;
+  }
+
+  SImpactInformation * const p_impacts = malloc(sizeof(SImpactInformation) * max_impact_capacity);
+  STileOccupancy occupancy;
+  STileOccupancy * const p_occupancy = needs_occupancy ? &occupancy : NULL;
+  if (p_impacts == NULL || (p_occupancy != NULL && !tile_occupancy_create(p_occupancy, grid.tiles_on_axis)))
+  {
+    fprintf(stderr, "Could not allocate the replay state\n");
+    free(p_impacts);
+    free(entries.p_entries);
+    return -1;
+  }
+
+  // Verify once outside of the timing, checksums cost more than the casts
+  SReplayState verification = { &grid, p_occupancy, p_impacts, 0, 0, 0 };
+  replay_entries(&verification, &entries, true);
+
+  SReplayState replay = { &grid, p_occupancy, p_impacts, 0, 0, 0 };
+  const double start_ns = now_ns();
+  for (int repeat = 0; repeat < repeat_count; repeat++) replay_entries(&replay, &entries, false);
+  const double replay_ns = now_ns() - start_ns;
+
+  printf("{\n");
+  printf("  \"recording\": \"%s\",\n", argv[1]);
+  printf("  \"entries\": %d,\n", entries.count);
+  printf("  \"repeats\": %d,\n", repeat_count);
+  printf("  \"rays\": %llu,\n", (unsigned long long)replay.rays);
+  printf("  \"mismatches\": %llu,\n", (unsigned long long)verification.mismatches);
+  printf("  \"rays_per_second\": %.0f,\n", replay.rays > 0 ? replay.rays / (replay_ns * 1e-9) : 0.0);
+  printf("  \"ns_per_ray\": %.3f,\n", replay.rays > 0 ? replay_ns / replay.rays : 0.0);
+  printf("  \"ns_per_impact\": %.3f\n", replay.impacts > 0 ? replay_ns / replay.impacts : 0.0);
+  printf("}\n");
+
+  if (p_occupancy != NULL) tile_occupancy_destroy(p_occupancy);
+  free(p_impacts);
+  free(entries.p_entries);
+
+  return verification.mismatches == 0 ? 0 : 1;
+}
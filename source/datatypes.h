@@ -2,6 +2,7 @@
 #define DATATYPES_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct {
   int x;
@@ -13,6 +14,17 @@ typedef struct {
   float y;
 } SVec2f;
 
+typedef struct {
+  double x;
+  double y;
+} SVec2d;
+
+// 16.16 fixed point
+typedef struct {
+  int32_t x;
+  int32_t y;
+} SVec2x;
+
 typedef struct {
   SVec2f min;
   SVec2f max;
@@ -23,10 +35,21 @@ typedef struct {
   bool y;
 } SVec2b;
 
+// The ray enters the impact tile at the impact time through the edge facing the
+// impact normal and leaves it at the exit time, at most at the end of the ray. The
+// origin tile is entered at time zero with a zero normal
 typedef struct {
   float impact_time;
   SVec2f impact_point;
   SVec2i impact_tile;
+  SVec2i impact_normal;
+  float exit_time;
 } SImpactInformation;
 
+typedef struct {
+  SVec2i origin_bottom_left;
+  SVec2i tile_dimensions;
+  SVec2i tiles_on_axis;
+} SGrid;
+
 #endif
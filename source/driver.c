@@ -4,7 +4,12 @@
 #include <stdlib.h>
 #include <SDL2/SDL_opengl.h>
 #include "datatypes.h"
-#include "helpers.h"
+#include "raycast.h"
+#include "profile.h"
+#include "ray_recording.h"
+#include "render_batch.h"
+#include "simulation_loop.h"
+#include "triple_buffer.h"
 #include <math.h>
 
 /*
@@ -14,53 +19,125 @@
     Things to improve & think about:
       - Test how the max buffer behaves over long distances
       - Are there any duplicate entries in the generated list?
-      - Avoid sorting like hell, this will cripple long raycasts - rather
-        optimize the algorithm and sort impact points right away by considering
-        both axis for every step and let an axis that is out of max steps be
-        ignored for future runs, until the second one runs out too
 */
 
 // Constants
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 
-// Function declarations
-//   Raycasting related function declarations
-void generateRaycastPointsAlongEdges(void);
+// The simulation ticks at a fixed rate on its own thread, independent of the
+// display refresh the rendering is bound to. A step time of zero ticks as fast as
+// the raycasts allow
+#define SIMULATION_STEP_SECONDS (1.0 / 120.0)
+
+// Raycast impact point generation related constants
+#define MAX_RAYCAST_IMPACTS 512
+#define RAY_FAN_COUNT 1024
+#define MAX_SNAPSHOT_RAYS (RAY_FAN_COUNT + 1)
+#define MAX_SNAPSHOT_IMPACTS 65536
+
+// Profiling related constants - Overlay bars are as wide as the screen for a
+// frame of this duration
+#define PROFILE_OVERLAY_FRAME_NS 16666667.0
+#define PROFILE_OVERLAY_MAX_ZONES 16
+#define PROFILE_TRACE_PATH "raycast_trace.json"
+
+// Ray recording related constants - Replay the recording with raycast_replay
+#define RAY_RECORDING_PATH "raycast_recording.bin"
+
+// Input as of the latest poll, handed from the render thread to the simulation
+typedef struct
+{
+  SVec2i mouse_screen_position;
+  bool mouse_left_button_held;
+  bool mouse_right_button_held;
+  bool ray_fan_enabled;
+  bool ray_recording_enabled;
+} SSceneInput;
+
+// Everything one simulation tick hands to the rendering. The impacts of ray i
+// are the ones from ray_impact_ends[i - 1] up to ray_impact_ends[i], the
+// controlled ray comes last
+typedef struct
+{
+  SVec2f raycast_origin;
+  int ray_count;
+  SVec2f ray_vectors[MAX_SNAPSHOT_RAYS];
+  int ray_impact_ends[MAX_SNAPSHOT_RAYS];
+  SImpactInformation impacts[MAX_SNAPSHOT_IMPACTS];
+} SSceneSnapshot;
 
+// Function declarations
 //   Housekeeping related function declarations
-void initializeState(void);
+bool initializeState(void);
+void teardownState(void);
+bool configure_grid(int argc, char * argv[]);
 void gameloop(SSDL2SetupResult setup_result);
 void poll_and_consume_input(bool * request_to_exit_application);
-void update_scene(void);
+void publish_scene_input(void);
+void update_scene(void * p_context, void * p_snapshot, uint64_t tick);
+void update_ray_recording(bool enable);
 void render_scene(SSDL2SetupResult setup_result);
+void build_grid_batch(void);
+void build_impact_batches(const SSceneSnapshot * p_snapshot);
+void build_profile_overlay_batch(uint64_t since_ns);
 
 // Compilation unit private state
 //   Input related state
 SVec2i mouse_screen_position = { 0, 0 };
 bool mouse_left_button_held = false;
 bool mouse_right_button_held = false;
-
-//   Grid related state
-const SVec2i gridTileDimensions = { 20, 20 };
-const SVec2i tilesOnGridAxis = { SCREEN_WIDTH / gridTileDimensions.x, SCREEN_HEIGHT / gridTileDimensions.y };
-const SVec2i gridDimensions = { tilesOnGridAxis.x * gridTileDimensions.x, tilesOnGridAxis.y * gridTileDimensions.y };
-const SVec2i gridOriginBottomLeft = { 0, 0 };
-const SAABB4f grid_bounding_box = {
-  { gridOriginBottomLeft.x, gridOriginBottomLeft.y },
-  { gridOriginBottomLeft.x + gridDimensions.x, gridOriginBottomLeft.y + gridDimensions.y },
-};
-
-// Raycasting related state
+bool ray_fan_enabled = false;
+bool ray_recording_enabled = false;
+
+//   Grid related state - Configured at startup, fills the screen by default
+SVec2i gridTileDimensions = { 20, 20 };
+SVec2i tilesOnGridAxis = { 0, 0 };
+SVec2i gridDimensions = { 0, 0 };
+SVec2i gridOriginBottomLeft = { 0, 0 };
+SAABB4f grid_bounding_box = { { 0.0f, 0.0f }, { 0.0f, 0.0f } };
+SGrid grid;
+
+// Simulation thread related state - Inputs flow in and snapshots flow out
+// through triple buffers, so neither thread ever waits for the other
+STripleBuffer scene_inputs;
+SSimulationLoop simulation;
+bool simulation_started = false;
+
+// Raycasting related state - Owned by the simulation thread
+SSceneInput simulated_input = { { 0, 0 }, false, false, false, false };
 SVec2f raycast_origin = { 0, 0 };
 SVec2f raycast_vector = { 0, 0 };
 SVec2f raycast_destination = { 0, 0 };
 
-// Raycast impact point generation related state
+// Ray recording related state - Owned by the simulation thread, toggle with R to
+// record every ray cast along with its result
+SRayRecordingWriter ray_recording;
+bool ray_recording_requested = false;
+bool ray_recording_open = false;
+
+// Rendering related state - The grid lines never change and are uploaded once,
+// everything else is rebuilt from the latest raycasts and uploaded once per frame
+SRenderBatch grid_line_batch;
+SRenderBatch tile_highlight_batch;
+SRenderBatch impact_point_batch;
+SRenderBatch ray_line_batch;
+SRenderBatch origin_point_batch;
+
+// Profiling related state - Zones only record in builds with RAYCAST_PROFILE,
+// toggle the overlay with P and write a Chrome trace with T
+bool profile_overlay_enabled = false;
+SRenderBatch profile_overlay_batch;
 
 // Main function
-int main(__attribute__((unused))int argc, __attribute__((unused))char * arvg[])
+int main(int argc, char * argv[])
 {
+  if (!configure_grid(argc, argv))
+  {
+    printf("\nUsage: %s [tile_width tile_height [tiles_x tiles_y [origin_x origin_y]]]\n", argv[0]);
+    return -1;
+  }
+
   SSDL2SetupResult result = sdl2_setup_for_2d_rendering(SCREEN_WIDTH, SCREEN_HEIGHT, "2dTileRaycasting ");
   if (result.setup_result != SDL2_SETUP_SUCCESS)
   {
@@ -70,28 +147,112 @@ int main(__attribute__((unused))int argc, __attribute__((unused))char * arvg[])
   }
 
   // Initialize before invoking the game loop
-  initializeState();
+  if (!initializeState())
+  {
+    printf("\nRender batches or the simulation could not be created. Exiting ...");
+    teardownState();
+    sdl2_setup_teardown(result);
+    return -1;
+  }
 
   // Gameloop - When done consider the game closing
   gameloop(result);
 
   // Free used resources
+  teardownState();
   sdl2_setup_teardown(result);
 
   // Back to OS
   return 0;
 }
 
-void initializeState() {
+bool initializeState() {
   // Flush output ...
   printf("\n");
   fflush(stdout);
+
+  // Vertex buffers need the GL context, which exists by now
+  const bool batches_created =
+    render_batch_create(&grid_line_batch, GL_LINES, GL_STATIC_DRAW) &&
+    render_batch_create(&tile_highlight_batch, GL_TRIANGLES, GL_STREAM_DRAW) &&
+    render_batch_create(&impact_point_batch, GL_POINTS, GL_STREAM_DRAW) &&
+    render_batch_create(&ray_line_batch, GL_LINES, GL_STREAM_DRAW) &&
+    render_batch_create(&origin_point_batch, GL_POINTS, GL_STREAM_DRAW) &&
+    render_batch_create(&profile_overlay_batch, GL_TRIANGLES, GL_STREAM_DRAW);
+  if (!batches_created) return false;
+
+  build_grid_batch();
+  profile_set_enabled(true);
+
+  // Start simulating once the first input can be picked up
+  if (!triple_buffer_create(&scene_inputs, sizeof(SSceneInput))) return false;
+  publish_scene_input();
+
+  simulation_started = simulation_loop_start(&simulation, sizeof(SSceneSnapshot), SIMULATION_STEP_SECONDS, update_scene, NULL);
+  return simulation_started;
+}
+
+void teardownState(void) {
+  if (simulation_started) simulation_loop_stop(&simulation);
+  simulation_started = false;
+  update_ray_recording(false);
+  triple_buffer_destroy(&scene_inputs);
+
+  render_batch_destroy(&grid_line_batch);
+  render_batch_destroy(&tile_highlight_batch);
+  render_batch_destroy(&impact_point_batch);
+  render_batch_destroy(&ray_line_batch);
+  render_batch_destroy(&origin_point_batch);
+  render_batch_destroy(&profile_overlay_batch);
 }
 
 // Function definitions
-void update_scene(void) {
+bool configure_grid(int argc, char * argv[])
+{
+  // Positional arguments in pairs - Tile size, tile count and grid origin
+  if (argc != 1 && argc != 3 && argc != 5 && argc != 7) return false;
+
+  if (argc >= 3) gridTileDimensions = (SVec2i) { atoi(argv[1]), atoi(argv[2]) };
+  if (gridTileDimensions.x <= 0 || gridTileDimensions.y <= 0) return false;
+
+  tilesOnGridAxis = (SVec2i) { SCREEN_WIDTH / gridTileDimensions.x, SCREEN_HEIGHT / gridTileDimensions.y };
+  if (argc >= 5) tilesOnGridAxis = (SVec2i) { atoi(argv[3]), atoi(argv[4]) };
+  if (tilesOnGridAxis.x <= 0 || tilesOnGridAxis.y <= 0) return false;
+
+  if (argc >= 7) gridOriginBottomLeft = (SVec2i) { atoi(argv[5]), atoi(argv[6]) };
+
+  grid = (SGrid) { gridOriginBottomLeft, gridTileDimensions, tilesOnGridAxis };
+  gridDimensions = raycast_grid_dimensions(&grid);
+  grid_bounding_box = raycast_grid_bounding_box(&grid);
+
+  return true;
+}
+
+void publish_scene_input(void) {
+  SSceneInput * const p_input = triple_buffer_write_slot(&scene_inputs);
+  *p_input = (SSceneInput) {
+    mouse_screen_position,
+    mouse_left_button_held,
+    mouse_right_button_held,
+    ray_fan_enabled,
+    ray_recording_enabled
+  };
+  triple_buffer_publish(&scene_inputs);
+}
+
+// Runs on the simulation thread, once per tick
+void update_scene(void * p_context, void * p_snapshot, uint64_t tick) {
+  PROFILE_ZONE("update_scene");
+  (void)p_context;
+  (void)tick;
+
+  // Keep the last input while the render thread has not polled a new one
+  if (triple_buffer_acquire(&scene_inputs)) simulated_input = *(const SSceneInput *)triple_buffer_read_slot(&scene_inputs);
+  const SVec2i mouse_screen_position = simulated_input.mouse_screen_position;
+  update_ray_recording(simulated_input.ray_recording_enabled);
+
   // Control raycasting origin and vector
-  if (mouse_right_button_held == true)
+  if (simulated_input.mouse_right_button_held == true)
   {
     // Update origin position
     raycast_origin = (SVec2f) { (float)mouse_screen_position.x, (float)mouse_screen_position.y };
@@ -102,7 +263,7 @@ void update_scene(void) {
     };
   }
 
-  if (mouse_left_button_held == true)
+  if (simulated_input.mouse_left_button_held == true)
   {
     // Track the end of the raycast
     raycast_destination = (SVec2f) {mouse_screen_position.x, mouse_screen_position.y};
@@ -113,8 +274,42 @@ void update_scene(void) {
     };
   }
 
-  // Generate points up to length for horizontal and vertical edges
-  generateRaycastPointsAlongEdges();
+  // Generate points up to length for horizontal and vertical edges, the fan
+  // first and the controlled ray last, straight into the snapshot
+  SSceneSnapshot * const p_scene = p_snapshot;
+  p_scene->raycast_origin = raycast_origin;
+  p_scene->ray_count = 0;
+
+  const float ray_length = sqrtf(raycast_vector.x * raycast_vector.x + raycast_vector.y * raycast_vector.y);
+  const int fan_ray_count = simulated_input.ray_fan_enabled ? RAY_FAN_COUNT : 0;
+  int impact_count = 0;
+  for (int ray_index = 0; ray_index <= fan_ray_count; ray_index++)
+  {
+    // Rays of the fan have the length of the one controlled, spread evenly around the origin
+    const float angle = 6.28318530718f * (float)ray_index / (float)RAY_FAN_COUNT;
+    const SVec2f vector = ray_index < fan_ray_count
+      ? (SVec2f) { cosf(angle) * ray_length, sinf(angle) * ray_length }
+      : raycast_vector;
+
+    const int impacts_left = MAX_SNAPSHOT_IMPACTS - impact_count;
+    SImpactBuffer impacts = {
+      p_scene->impacts + impact_count,
+      impacts_left < MAX_RAYCAST_IMPACTS ? impacts_left : MAX_RAYCAST_IMPACTS,
+      0
+    };
+    const ERaycastResultType result = raycast_grid(&grid, raycast_origin, vector, &impacts);
+    if (ray_recording_open)
+    {
+      SRayRecordingEntry entry = { .type = RAY_RECORDING_ENUMERATE, .origin = raycast_origin, .vector = vector, .impact_capacity = (uint32_t)impacts.capacity };
+      ray_recording_set_result(&entry, result, impacts.p_impacts, impacts.count);
+      ray_recording_write(&ray_recording, &entry);
+    }
+    impact_count += impacts.count;
+
+    p_scene->ray_vectors[p_scene->ray_count] = vector;
+    p_scene->ray_impact_ends[p_scene->ray_count] = impact_count;
+    p_scene->ray_count++;
+  }
   /*
 
           - generate hori and verti edge points upto ray length
@@ -142,396 +337,253 @@ void update_scene(void) {
   */
 }
 
-int sort_impact_information(const void * info_left, const void * info_right)
-{
-    const SImpactInformation * p_info_left = (const SImpactInformation *)info_left;
-    const SImpactInformation * p_info_right = (const SImpactInformation *)info_right;
-
-    if (p_info_left->impact_time < p_info_right->impact_time)
-      return -1;
-    else if (p_info_left->impact_time > p_info_right->impact_time)
-      return 1;
-    else
-      return 0;
-}
-
-void generateRaycastPointsAlongEdges(void) {
-    // Parameterize list building
-    const int MAX_POINTS_PER_AXIS = 256;
-    int points_recorded_raycast_x = 0;
-    int points_recorded_raycast_y = 0;
-    SImpactInformation * const p_info_raycast_x = malloc(sizeof(SImpactInformation) * MAX_POINTS_PER_AXIS);
-    SImpactInformation * const p_info_raycast_y = malloc(sizeof(SImpactInformation) * MAX_POINTS_PER_AXIS);
-
-    // Start computing all impact points
-    const SVec2f raycast_grid_relative_origin = {
-      (raycast_origin.x - gridOriginBottomLeft.x),
-      (raycast_origin.y - gridOriginBottomLeft.y)
-    };
+// Opens or closes the recording once the requested state changes, a recording
+// that could not be opened is only retried on the next request. Runs on the
+// simulation thread, or after it stopped
+void update_ray_recording(bool enable) {
+  if (enable == ray_recording_requested) return;
+  ray_recording_requested = enable;
 
-    // Consider raycast only when ray origin inside the grid
-    const bool ray_origin_out_of_grid_bounds =
-      (raycast_grid_relative_origin.x < 0.0f)              ||
-      (raycast_grid_relative_origin.x >= gridDimensions.x) ||
-      (raycast_grid_relative_origin.y < 0.0f)              ||
-      (raycast_grid_relative_origin.y >= gridDimensions.y);
-
-    if (ray_origin_out_of_grid_bounds) return;
-
-    // Determine first impact point between the ray and the tile it is contained in based
-    // on the ray direction and the first edge the ray impacts for each axis
-    const SVec2i raycast_tile_origin = {
-      (int)(raycast_grid_relative_origin.x / gridTileDimensions.x),
-      (int)(raycast_grid_relative_origin.y / gridTileDimensions.y)
-    };
-    const SVec2i raycast_direction = helper_vector_direction(raycast_vector);
+  if (enable)
+  {
+    ray_recording_open = ray_recording_writer_open(&ray_recording, RAY_RECORDING_PATH, &grid);
+    if (ray_recording_open) printf("Recording rays to %s\n", RAY_RECORDING_PATH);
+    else printf("Could not create ray recording %s\n", RAY_RECORDING_PATH);
+  }
+  else if (ray_recording_open)
+  {
+    ray_recording_open = false;
+    if (ray_recording_writer_close(&ray_recording)) printf("Wrote ray recording %s\n", RAY_RECORDING_PATH);
+    else printf("Could not write ray recording %s\n", RAY_RECORDING_PATH);
+  }
+  fflush(stdout);
+}
 
-    // When the ray is positive (x or y axis) it must be swept against the right tile
-    // edge, if it is negative (x or y axis) it must be swept against the left tile edge
-    const SVec2i tile_edge_in_ray_direction = {
-      raycast_direction.x > 0 ? (raycast_tile_origin.x + raycast_direction.x) * gridTileDimensions.x : raycast_tile_origin.x * gridTileDimensions.x,
-      raycast_direction.y > 0 ? (raycast_tile_origin.y + raycast_direction.y) * gridTileDimensions.y : raycast_tile_origin.y * gridTileDimensions.y,
-    };
+void build_grid_batch(void) {
+  const SRenderColor grid_line_color = { 0.25f, 0.25f, 0.25f, 1.0f };
+  const SRenderColor grid_border_color = { 0.0f, 0.75f, 0.0f, 1.0f };
 
-    // Determine impact time between the ray vector and the tile containing the origin
-    // Beware of ray vector axis parallel to any grid axis
-    const SVec2f raycast_grid_origin = { raycast_origin.x - gridOriginBottomLeft.x, raycast_origin.y - gridOriginBottomLeft.y};
-    const SVec2f intersect_times_initial = {
-      (tile_edge_in_ray_direction.x - raycast_grid_origin.x) / raycast_vector.x,
-      (tile_edge_in_ray_direction.y - raycast_grid_origin.y) / raycast_vector.y
-    };
+  render_batch_clear(&grid_line_batch);
 
-    // Determine if the ray hits the edge and if, at what exact position
-    const SVec2b initial_ray_hits = {
-      raycast_direction.x != 0 && intersect_times_initial.x < 1.0f,
-      raycast_direction.y != 0 && intersect_times_initial.y < 1.0f,
-    };
+  // Horizontal grid lines from bottom to top
+  for (int verticalGridLineIndex = 0; verticalGridLineIndex <= tilesOnGridAxis.y; verticalGridLineIndex++)
+  {
+    const float line_y = gridOriginBottomLeft.y + verticalGridLineIndex * gridTileDimensions.y;
+    render_batch_line(&grid_line_batch, gridOriginBottomLeft.x, line_y, gridOriginBottomLeft.x + gridDimensions.x, line_y, grid_line_color);
+  }
+  // Vertical grid lines from left to right
+  for (int horizontalGridLineIndex = 0; horizontalGridLineIndex <= tilesOnGridAxis.x; horizontalGridLineIndex++)
+  {
+    const float line_x = gridOriginBottomLeft.x + horizontalGridLineIndex * gridTileDimensions.x;
+    render_batch_line(&grid_line_batch, line_x, gridOriginBottomLeft.y, line_x, gridOriginBottomLeft.y + gridDimensions.y, grid_line_color);
+  }
 
-    // Pre-compute data needed for both axis
-    const float raycast_length = sqrtf(raycast_vector.x * raycast_vector.x + raycast_vector.y * raycast_vector.y);
+  // Grid border lines, drawn after and so over the grid lines
+  render_batch_line(&grid_line_batch, grid_bounding_box.min.x, grid_bounding_box.min.y, grid_bounding_box.max.x, grid_bounding_box.min.y, grid_border_color);
+  render_batch_line(&grid_line_batch, grid_bounding_box.max.x, grid_bounding_box.min.y, grid_bounding_box.max.x, grid_bounding_box.max.y, grid_border_color);
+  render_batch_line(&grid_line_batch, grid_bounding_box.max.x, grid_bounding_box.max.y, grid_bounding_box.min.x, grid_bounding_box.max.y, grid_border_color);
+  render_batch_line(&grid_line_batch, grid_bounding_box.min.x, grid_bounding_box.max.y, grid_bounding_box.min.x, grid_bounding_box.min.y, grid_border_color);
 
-    // Step through all impact points for vertical tile edges
-    if (raycast_direction.x != 0 && initial_ray_hits.x == true)
-    {
-      // Note: We know the x axis of the ray hit the vertical tile edge containing the ray origin
-      SVec2f initial_impact_position_raycast_x = {
-        raycast_origin.x + raycast_vector.x * intersect_times_initial.x,
-        raycast_origin.y + raycast_vector.y * intersect_times_initial.x
-      };
-
-      bool initial_impact_position_raycast_x_oob =
-        initial_impact_position_raycast_x.x < grid_bounding_box.min.x ||
-        initial_impact_position_raycast_x.x > grid_bounding_box.max.x ||
-        initial_impact_position_raycast_x.y < grid_bounding_box.min.y ||
-        initial_impact_position_raycast_x.y > grid_bounding_box.max.y;
-
-      if (initial_impact_position_raycast_x_oob) return;
-
-      // Determine which tile the impact hits
-      SVec2i tiled_impact_point = {
-        tile_edge_in_ray_direction.x / gridTileDimensions.x,
-        initial_impact_position_raycast_x.y / gridTileDimensions.y
-      };
-      SVec2i impacted_tile_based_on_ray = {
-        raycast_vector.x >= 0 ? tiled_impact_point.x : tiled_impact_point.x - 1,
-        tiled_impact_point.y
-      };
-
-      // Record initial impact on vertical edge
-      if (points_recorded_raycast_x < MAX_POINTS_PER_AXIS) {
-        p_info_raycast_x[points_recorded_raycast_x++] = (SImpactInformation) {
-          intersect_times_initial.x,
-          initial_impact_position_raycast_x,
-          impacted_tile_based_on_ray
-        };
-      }
+  render_batch_upload(&grid_line_batch);
+}
 
-      // Note: We know the vertical edge hit is in bound of the grid
-      // Now determine all subsequent impacts on the vertical edges
-      //
-      // Do not accumulate the distances but rather determine the required lengths to avoid rounding errors
-      // over large raycast distances
-      int step_index = 1;
-      const float horizontal_edge_stepsize = fabs((raycast_vector.y * gridTileDimensions.x) / raycast_vector.x);
-      const SVec2f step_size = { gridTileDimensions.x * raycast_direction.x, horizontal_edge_stepsize * raycast_direction.y };
-
-      // Account for the distance from origin to the initial tile impact
-      const SVec2f origin_to_initial_impact = {
-        initial_impact_position_raycast_x.x - raycast_origin.x,
-        initial_impact_position_raycast_x.y - raycast_origin.y
-      };
-      const float origin_to_initial_impact_length = sqrtf(
-        origin_to_initial_impact.x * origin_to_initial_impact.x +
-        origin_to_initial_impact.y * origin_to_initial_impact.y
-      );
-
-      // Add points on vertical tile edges to list until out of grid bounds or ray length overshot
-      while (true) {
-        // Compute the impact point for the current step based on the initial impact
-        // The step size is always the same for a given axis, so the triangle edges can be
-        // determined from the grid tilesize and the ration of the raycast vector component lengths
-        const SVec2f stepped_edge_impact = {
-          initial_impact_position_raycast_x.x + step_size.x * step_index,
-          initial_impact_position_raycast_x.y + step_size.y * step_index
-        };
-
-        // Stop stepping and ignore next impact point when the impact is out of grid bounds
-        const bool edge_in_bounds = !(
-          stepped_edge_impact.x < grid_bounding_box.min.x ||
-          stepped_edge_impact.x > grid_bounding_box.max.x ||
-          stepped_edge_impact.y < grid_bounding_box.min.y ||
-          stepped_edge_impact.y > grid_bounding_box.max.y
-        );
-        if (!edge_in_bounds) break;
-
-        // Stop stepping and ignore next impact point when the impact is further than the ray can reach
-        const float step_length = sqrtf(step_size.x * step_size.x + step_size.y * step_size.y) * step_index;
-        const float total_current_step_length = origin_to_initial_impact_length + step_length;
-        const bool ray_reaches_impact = raycast_length >= total_current_step_length;
-        if (!ray_reaches_impact) break;
-
-        // Determine which tile the impact hits
-        SVec2i tiled_impact_point = {
-          stepped_edge_impact.x / gridTileDimensions.x,
-          stepped_edge_impact.y / gridTileDimensions.y
-        };
-        SVec2i impacted_tile_based_on_ray = {
-          raycast_vector.x >= 0 ? tiled_impact_point.x : tiled_impact_point.x - 1,
-          tiled_impact_point.y
-        };
-
-        // Record the stepped impact point to the list of vertical impacts for the raycast x component
-        if (points_recorded_raycast_x < MAX_POINTS_PER_AXIS) {
-          const float stepped_edge_impact_time = total_current_step_length / raycast_length;
-          p_info_raycast_x[points_recorded_raycast_x++] = (SImpactInformation) {
-            stepped_edge_impact_time,
-            stepped_edge_impact,
-            impacted_tile_based_on_ray
-          };
-        }
+// Adds the impacts of one ray, from lowest to highest impact time in ranging color
+static void batch_impacts(const SImpactInformation * p_impacts, int impact_count) {
+  const SRenderColor impact_point_color = { 0.0f, 1.0f, 0.0f, 1.0f };
+  const float color_index_step_increment = 1.0 / (float)impact_count;
+  for (int impact_info_index = 0; impact_info_index < impact_count; impact_info_index++)
+  {
+    const SImpactInformation * const p_current_info = p_impacts + impact_info_index;
 
-        // Prepare for the next step
-        step_index++;
-      }
-    }
+    render_batch_point(&impact_point_batch, p_current_info->impact_point.x, p_current_info->impact_point.y, impact_point_color);
 
-    // Step through all impact points for horizontal tile edges
-    if (raycast_direction.y != 0 && initial_ray_hits.y == true)
-    {
-      // Note: We know the y axis of the ray hit the horizontal tile edge containing the ray origin
-      SVec2f initial_impact_position_raycast_y = {
-        raycast_origin.x + raycast_vector.x * intersect_times_initial.y,
-        raycast_origin.y + raycast_vector.y * intersect_times_initial.y
-      };
-
-      bool initial_impact_position_raycast_y_oob =
-        initial_impact_position_raycast_y.x < grid_bounding_box.min.x ||
-        initial_impact_position_raycast_y.x > grid_bounding_box.max.x ||
-        initial_impact_position_raycast_y.y < grid_bounding_box.min.y ||
-        initial_impact_position_raycast_y.y > grid_bounding_box.max.y;
-
-      if (initial_impact_position_raycast_y_oob) return;
-
-      // Determine which tile the impact hits
-      SVec2i tiled_impact_point = {
-        initial_impact_position_raycast_y.x / gridTileDimensions.x,
-        tile_edge_in_ray_direction.y / gridTileDimensions.y
-      };
-      SVec2i impacted_tile_based_on_ray = {
-        tiled_impact_point.x,
-        raycast_vector.y >= 0 ? tiled_impact_point.y : tiled_impact_point.y - 1
-      };
-
-      // Record initial impact on vertical edge
-      if (points_recorded_raycast_y < MAX_POINTS_PER_AXIS) {
-        p_info_raycast_y[points_recorded_raycast_y++] = (SImpactInformation) {
-          intersect_times_initial.y,
-          initial_impact_position_raycast_y,
-          impacted_tile_based_on_ray
-        };
-      }
+    const float time_color = 1.0 - color_index_step_increment * impact_info_index;
+    const float tile_min_x = gridOriginBottomLeft.x + p_current_info->impact_tile.x * gridTileDimensions.x;
+    const float tile_min_y = gridOriginBottomLeft.y + p_current_info->impact_tile.y * gridTileDimensions.y;
+    render_batch_rect(
+      &tile_highlight_batch,
+      tile_min_x,
+      tile_min_y,
+      tile_min_x + gridTileDimensions.x,
+      tile_min_y + gridTileDimensions.y,
+      (SRenderColor) { time_color, time_color, time_color, 1.0f }
+    );
+  }
+}
 
-      // Note: We know the horizontal edge hit is in bound of the grid
-      // Now determine all subsequent impacts on the horizontal edges
-      //
-      // Do not accumulate the distances but rather determine the required lengths to avoid rounding errors
-      // over large raycast distances
-      int step_index = 1;
-      const float vertical_edge_stepsize = fabs((raycast_vector.x * gridTileDimensions.y) / raycast_vector.y);
-      const SVec2f step_size = { vertical_edge_stepsize * raycast_direction.x, gridTileDimensions.y * raycast_direction.y };
-
-      // Account for the distance from origin to the initial tile impact
-      const SVec2f origin_to_initial_impact = {
-        initial_impact_position_raycast_y.x - raycast_origin.x,
-        initial_impact_position_raycast_y.y - raycast_origin.y
-      };
-      const float origin_to_initial_impact_length = sqrtf(
-        origin_to_initial_impact.x * origin_to_initial_impact.x +
-        origin_to_initial_impact.y * origin_to_initial_impact.y
-      );
-
-      // Add points on horizontal tile edges to list until out of grid bounds or ray length overshot
-      while (true) {
-        // Compute the impact point for the current step based on the initial impact
-        // The step size is always the same for a given axis, so the triangle edges can be
-        // determined from the grid tilesize and the ration of the raycast vector component lengths
-        const SVec2f stepped_edge_impact = {
-          initial_impact_position_raycast_y.x + step_size.x * step_index,
-          initial_impact_position_raycast_y.y + step_size.y * step_index
-        };
-
-        // Stop stepping and ignore next impact point when the impact is out of grid bounds
-        const bool edge_in_bounds = !(
-          stepped_edge_impact.x < grid_bounding_box.min.x ||
-          stepped_edge_impact.x > grid_bounding_box.max.x ||
-          stepped_edge_impact.y < grid_bounding_box.min.y ||
-          stepped_edge_impact.y > grid_bounding_box.max.y
-        );
-        if (!edge_in_bounds) break;
-
-        // Stop stepping and ignore next impact point when the impact is further than the ray can reach
-        const float step_length = sqrtf(step_size.x * step_size.x + step_size.y * step_size.y) * step_index;
-        const float total_current_step_length = origin_to_initial_impact_length + step_length;
-        const bool ray_reaches_impact = raycast_length >= total_current_step_length;
-        if (!ray_reaches_impact) break;
-
-        // Determine which tile the impact hits
-        SVec2i tiled_impact_point = {
-          stepped_edge_impact.x / gridTileDimensions.x,
-          stepped_edge_impact.y / gridTileDimensions.y
-        };
-        SVec2i impacted_tile_based_on_ray = {
-          tiled_impact_point.x,
-          raycast_vector.y >= 0 ? tiled_impact_point.y : tiled_impact_point.y - 1
-        };
-
-        // Record the stepped impact point to the list of horizontal impacts for the raycast x component
-        if (points_recorded_raycast_y < MAX_POINTS_PER_AXIS) {
-          const float stepped_edge_impact_time = total_current_step_length / raycast_length;
-          p_info_raycast_y[points_recorded_raycast_y++] = (SImpactInformation) {
-            stepped_edge_impact_time,
-            stepped_edge_impact,
-            impacted_tile_based_on_ray
-          };
-        }
+void build_impact_batches(const SSceneSnapshot * p_snapshot) {
+  PROFILE_ZONE("build_impact_batches");
+  const SRenderColor ray_color = { 1.0f, 0.0f, 0.0f, 1.0f };
+  const SRenderColor fan_ray_color = { 1.0f, 0.0f, 0.0f, 0.25f };
+  const SVec2f origin = p_snapshot->raycast_origin;
 
-        // Prepare for the next step
-        step_index++;
-      }
-    }
+  render_batch_clear(&tile_highlight_batch);
+  render_batch_clear(&impact_point_batch);
+  render_batch_clear(&ray_line_batch);
+  render_batch_clear(&origin_point_batch);
 
-  // Build a single single list of impact information from both sorted buffers
-  // Are there any duplicates to worry about? If so, what is the causing edge-case?
-  const int total_tiles_impacted = points_recorded_raycast_x + points_recorded_raycast_y;
-  SImpactInformation * p_all_impact_infos_distance_ascending = malloc(sizeof(SImpactInformation) * total_tiles_impacted);
-  int copy_index = 0;
+  int impact_begin = 0;
+  for (int ray_index = 0; ray_index < p_snapshot->ray_count; ray_index++)
+  {
+    const int impact_end = p_snapshot->ray_impact_ends[ray_index];
+    batch_impacts(p_snapshot->impacts + impact_begin, impact_end - impact_begin);
+    impact_begin = impact_end;
 
-  // Copy both axis impact buffers into a single one an sort the result
-  for (int info_x_copy_index = 0; info_x_copy_index < points_recorded_raycast_x; info_x_copy_index++)
-    p_all_impact_infos_distance_ascending[copy_index++] = p_info_raycast_x[info_x_copy_index];
+    const SVec2f vector = p_snapshot->ray_vectors[ray_index];
+    const bool controlled_ray = ray_index == p_snapshot->ray_count - 1;
+    render_batch_line(&ray_line_batch, origin.x, origin.y, origin.x + vector.x, origin.y + vector.y, controlled_ray ? ray_color : fan_ray_color);
+  }
 
-  for (int info_y_copy_index = 0; info_y_copy_index < points_recorded_raycast_y; info_y_copy_index++)
-    p_all_impact_infos_distance_ascending[copy_index++] = p_info_raycast_y[info_y_copy_index];
+  // Raycasting origin
+  render_batch_point(&origin_point_batch, origin.x, origin.y, ray_color);
 
-  qsort(p_all_impact_infos_distance_ascending, copy_index, sizeof(SImpactInformation), sort_impact_information);
+  render_batch_upload(&tile_highlight_batch);
+  render_batch_upload(&impact_point_batch);
+  render_batch_upload(&ray_line_batch);
+  render_batch_upload(&origin_point_batch);
+}
 
-  // Render all intersected times from lowest to highest impact time in ranging color
-  SImpactInformation * p_current_info = NULL;
-  const float color_index_step_increment = 1.0 / (float)total_tiles_impacted;
-  for (int impact_info_index = 0; impact_info_index < total_tiles_impacted; impact_info_index++)
+// One bar per zone name for the time spent in it since the given time, which
+// includes zones of the simulation thread
+void build_profile_overlay_batch(uint64_t since_ns) {
+  const SRenderColor bar_colors[] = {
+    { 1.0f, 0.6f, 0.2f, 0.9f },
+    { 0.3f, 0.7f, 1.0f, 0.9f },
+    { 1.0f, 0.9f, 0.3f, 0.9f },
+    { 0.8f, 0.4f, 1.0f, 0.9f }
+  };
+  const int bar_color_count = (int)(sizeof(bar_colors) / sizeof(bar_colors[0]));
+  const float bar_height = 8.0f;
+  const float bar_spacing = 4.0f;
+
+  SProfileZoneTotal totals[PROFILE_OVERLAY_MAX_ZONES];
+  const int total_count = profile_zone_totals(since_ns, totals, PROFILE_OVERLAY_MAX_ZONES);
+
+  render_batch_clear(&profile_overlay_batch);
+  if (total_count > 0)
   {
-    // Select single info for rendering
-    p_current_info = p_all_impact_infos_distance_ascending + impact_info_index;
-
-    // No batching - Just render for now
-    glColor4f(0.0f, 1.0f, 0.0f, 1.0f);
-    glPointSize(6.0f);
-    glBegin(GL_POINT);
-      glVertex2f(p_current_info->impact_point.x, p_current_info->impact_point.y);
-    glEnd();
-
-    const float time_color = 1.0 - color_index_step_increment * impact_info_index;
-    glColor4f(time_color, time_color, time_color, 1.0f);
-    glRectf(
-      p_current_info->impact_tile.x * gridTileDimensions.x,
-      p_current_info->impact_tile.y * gridTileDimensions.y,
-      p_current_info->impact_tile.x * gridTileDimensions.x + gridTileDimensions.x,
-      p_current_info->impact_tile.y * gridTileDimensions.y + gridTileDimensions.y
-    );
+    const float top = SCREEN_HEIGHT - bar_spacing;
+    const float bottom = top - total_count * (bar_height + bar_spacing) - bar_spacing;
+    render_batch_rect(&profile_overlay_batch, 0.0f, bottom, SCREEN_WIDTH, SCREEN_HEIGHT, (SRenderColor) { 0.0f, 0.0f, 0.0f, 0.5f });
   }
-
-  // Free used resources
-  free(p_info_raycast_x);
-  free(p_info_raycast_y);
-  free(p_all_impact_infos_distance_ascending);
+  for (int total = 0; total < total_count; total++)
+  {
+    const float bar_top = SCREEN_HEIGHT - bar_spacing - total * (bar_height + bar_spacing) - bar_spacing;
+    const float bar_width = (float)(totals[total].total_ns / PROFILE_OVERLAY_FRAME_NS) * SCREEN_WIDTH;
+    render_batch_rect(&profile_overlay_batch, bar_spacing, bar_top - bar_height, bar_spacing + bar_width, bar_top, bar_colors[total % bar_color_count]);
+  }
+  render_batch_upload(&profile_overlay_batch);
 }
 
 void render_scene(SSDL2SetupResult setup_result) {
-  // Render the grid
-  glLineWidth(1.0f);
-  glColor4f(0.25f, 0.25f, 0.25f, 1.0f);
-  glBegin(GL_LINES);
-    // Horizontal grid lines from bottom to top
-    for (int verticalGridLineIndex = 0; verticalGridLineIndex <= tilesOnGridAxis.y; verticalGridLineIndex++)
-    {
-      glVertex2i(gridOriginBottomLeft.x, gridOriginBottomLeft.y + verticalGridLineIndex * gridTileDimensions.y);
-      glVertex2i(gridOriginBottomLeft.x + gridDimensions.x, gridOriginBottomLeft.y + verticalGridLineIndex * gridTileDimensions.y);
-    }
-    // Vertical grid lines from left to right
-    for (int horizontalGridLineIndex = 0; horizontalGridLineIndex <= tilesOnGridAxis.x; horizontalGridLineIndex++)
-    {
-      glVertex2i(gridOriginBottomLeft.x + horizontalGridLineIndex * gridTileDimensions.x, gridOriginBottomLeft.y);
-      glVertex2i(gridOriginBottomLeft.x + horizontalGridLineIndex * gridTileDimensions.x, gridOriginBottomLeft.y + gridDimensions.y);
-    }
-  glEnd();
+  PROFILE_ZONE("render_scene");
+
+  // Render the impacts of the latest raycasts below the grid
+  render_batch_draw(&tile_highlight_batch);
+  glPointSize(6.0f);
+  render_batch_draw(&impact_point_batch);
 
-  // Render grid border lines
+  // Render the grid and its border
   glLineWidth(1.0f);
-  glColor4f(0.00f, 0.75f, 0.00, 1.0f);
-  glBegin(GL_LINE_LOOP);
-    glVertex2f(grid_bounding_box.min.x, grid_bounding_box.min.y);
-    glVertex2f(grid_bounding_box.max.x, grid_bounding_box.min.y);
-    glVertex2f(grid_bounding_box.max.x, grid_bounding_box.max.y);
-    glVertex2f(grid_bounding_box.min.x, grid_bounding_box.max.y);
-  glEnd();
+  render_batch_draw(&grid_line_batch);
 
   // Render raycasting origin and ray
-  glColor4f(1.0f, 0.0f, 0.0f, 1.0f);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   glLineWidth(2.0f);
-  glBegin(GL_LINES);
-    glVertex2f(raycast_origin.x, raycast_origin.y);
-    glVertex2f(raycast_destination.x, raycast_destination.y);
-  glEnd();
+  render_batch_draw(&ray_line_batch);
+  glDisable(GL_BLEND);
 
-  glColor4f(1.0f, 0.0f, 0.0f, 1.0f);
   glPointSize(12.0f);
-  glBegin(GL_POINTS);
-    glVertex2f(raycast_origin.x, raycast_origin.y);
-  glEnd();
+  render_batch_draw(&origin_point_batch);
+
+  // Render the profiling overlay above everything
+  if (profile_overlay_enabled)
+  {
+    glEnable(GL_BLEND);
+    render_batch_draw(&profile_overlay_batch);
+    glDisable(GL_BLEND);
+  }
 }
 
 void gameloop(SSDL2SetupResult setup_result)
 {
     // Gameloop state
     bool request_to_exit_application = false;
+    Uint32 report_start_ms = SDL_GetTicks();
+    SSimulationStats report_stats = simulation_loop_stats(&simulation);
+    int frames_since_report = 0;
+    uint64_t previous_frame_start_ns = profile_now_ns();
+#ifdef RAYCAST_PROFILE
+    uint64_t report_counters[PROFILE_COUNTER_COUNT] = { 0 };
+#endif
 
     while(!request_to_exit_application)
     {
+      PROFILE_ZONE("frame");
+
+      // The overlay shows the zones of the whole previous frame
+      const uint64_t frame_start_ns = profile_now_ns();
+      if (profile_overlay_enabled) build_profile_overlay_batch(previous_frame_start_ns);
+      previous_frame_start_ns = frame_start_ns;
+
       glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
       glClear(GL_COLOR_BUFFER_BIT);
 
       poll_and_consume_input(&request_to_exit_application);
+      publish_scene_input();
 
-      update_scene();
+      // Rebuild the batches only when the simulation finished a tick since the
+      // last frame, otherwise draw the same snapshot again
+      if (simulation_loop_acquire(&simulation)) build_impact_batches(simulation_loop_snapshot(&simulation));
 
       render_scene(setup_result);
 
-      SDL_GL_SwapWindow(setup_result.p_window);
+      {
+        PROFILE_ZONE("swap_window");
+        SDL_GL_SwapWindow(setup_result.p_window);
+      }
+      frames_since_report++;
+      profile_sample_counters();
+
+      // Report how fast each side runs on its own once per second
+      const Uint32 ticks_ms = SDL_GetTicks();
+      if (ticks_ms - report_start_ms >= 1000)
+      {
+        const SSimulationStats stats = simulation_loop_stats(&simulation);
+        const double seconds = (ticks_ms - report_start_ms) / 1000.0;
+        printf(
+          "render %.1f fps, simulation %.1f ticks/s, %.2f ms per tick, %llu ticks dropped\n",
+          frames_since_report / seconds,
+          (stats.ticks - report_stats.ticks) / seconds,
+          stats.ticks > report_stats.ticks ? (stats.busy_ns - report_stats.busy_ns) * 1e-6 / (stats.ticks - report_stats.ticks) : 0.0,
+          (unsigned long long)stats.dropped_ticks
+        );
+
+#ifdef RAYCAST_PROFILE
+        uint64_t counters[PROFILE_COUNTER_COUNT];
+        for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) counters[counter] = profile_counter(counter);
+        printf(
+          "  %.0f rays/s, %.0f tiles/s, %llu allocations\n",
+          (counters[PROFILE_COUNTER_RAYS_CAST] - report_counters[PROFILE_COUNTER_RAYS_CAST]) / seconds,
+          (counters[PROFILE_COUNTER_TILES_STEPPED] - report_counters[PROFILE_COUNTER_TILES_STEPPED]) / seconds,
+          (unsigned long long)(counters[PROFILE_COUNTER_ALLOCATIONS] - report_counters[PROFILE_COUNTER_ALLOCATIONS])
+        );
+        for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) report_counters[counter] = counters[counter];
+#endif
+        fflush(stdout);
+
+        report_start_ms = ticks_ms;
+        report_stats = stats;
+        frames_since_report = 0;
+      }
     }
 }
 
 void poll_and_consume_input(bool * request_to_exit_application)
 {
+  PROFILE_ZONE("poll_and_consume_input");
+
   SDL_Event some_event;
   while(SDL_PollEvent(&some_event) != 0)
   {
@@ -547,6 +599,20 @@ void poll_and_consume_input(bool * request_to_exit_application)
           case SDLK_ESCAPE:
             *request_to_exit_application = true;
             break;
+          case SDLK_f:
+            ray_fan_enabled = !ray_fan_enabled;
+            break;
+          case SDLK_r:
+            ray_recording_enabled = !ray_recording_enabled;
+            break;
+          case SDLK_p:
+            profile_overlay_enabled = !profile_overlay_enabled;
+            break;
+          case SDLK_t:
+            if (profile_write_chrome_trace(PROFILE_TRACE_PATH)) printf("Wrote profiling trace to %s\n", PROFILE_TRACE_PATH);
+            else printf("Could not write profiling trace to %s\n", PROFILE_TRACE_PATH);
+            fflush(stdout);
+            break;
         }
         break;
     }
@@ -0,0 +1,63 @@
+#include "frame_arena.h"
+#include "profile.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+static size_t align_offset(const SFrameArena * p_arena, size_t alignment)
+{
+  // Align the address rather than the offset, the base is only aligned for max_align_t
+  const uintptr_t address = (uintptr_t)(p_arena->p_memory + p_arena->used);
+  const uintptr_t aligned_address = (address + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+
+  return p_arena->used + (size_t)(aligned_address - address);
+}
+
+bool frame_arena_create(SFrameArena * p_arena, size_t capacity)
+{
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  p_arena->p_memory = malloc(capacity);
+  p_arena->capacity = p_arena->p_memory != NULL ? capacity : 0;
+  p_arena->used = 0;
+
+  return p_arena->p_memory != NULL;
+}
+
+void frame_arena_destroy(SFrameArena * p_arena)
+{
+  free(p_arena->p_memory);
+  p_arena->p_memory = NULL;
+  p_arena->capacity = 0;
+  p_arena->used = 0;
+}
+
+void frame_arena_reset(SFrameArena * p_arena)
+{
+  p_arena->used = 0;
+}
+
+void * frame_arena_allocate(SFrameArena * p_arena, size_t size, size_t alignment)
+{
+  const size_t offset = align_offset(p_arena, alignment);
+  if (offset > p_arena->capacity || size > p_arena->capacity - offset) return NULL;
+
+  p_arena->used = offset + size;
+  return p_arena->p_memory + offset;
+}
+
+void * frame_arena_reserve_remaining(SFrameArena * p_arena, size_t alignment, size_t * p_reserved_size)
+{
+  const size_t offset = align_offset(p_arena, alignment);
+  if (offset > p_arena->capacity)
+  {
+    *p_reserved_size = 0;
+    return NULL;
+  }
+
+  *p_reserved_size = p_arena->capacity - offset;
+  return p_arena->p_memory + offset;
+}
+
+void frame_arena_commit(SFrameArena * p_arena, void * p_reservation, size_t used_size)
+{
+  p_arena->used = (size_t)((unsigned char *)p_reservation - p_arena->p_memory) + used_size;
+}
@@ -0,0 +1,29 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Linear allocator for results that live for a single tick. Allocations are
+// never freed individually, the whole arena is reset once per tick instead.
+// An arena is not synchronized, so every thread owns its own arena
+typedef struct
+{
+  unsigned char * p_memory;
+  size_t capacity;
+  size_t used;
+} SFrameArena;
+
+bool frame_arena_create(SFrameArena * p_arena, size_t capacity);
+void frame_arena_destroy(SFrameArena * p_arena);
+void frame_arena_reset(SFrameArena * p_arena);
+
+// Returns NULL when the remaining arena memory cannot hold the allocation
+void * frame_arena_allocate(SFrameArena * p_arena, size_t size, size_t alignment);
+
+// Hands out all remaining memory aligned for the caller to fill. Only the first
+// used_size bytes are kept when the reservation is committed
+void * frame_arena_reserve_remaining(SFrameArena * p_arena, size_t alignment, size_t * p_reserved_size);
+void frame_arena_commit(SFrameArena * p_arena, void * p_reservation, size_t used_size);
+
+#endif
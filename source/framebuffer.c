@@ -0,0 +1,136 @@
+#include "framebuffer.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+// First pixel whose center lies at or past the coordinate, clamped to [0, limit]
+static int first_covered_pixel(float coordinate, int limit)
+{
+  const float pixel = ceilf(coordinate - 0.5f);
+  if (!(pixel > 0.0f)) return 0;
+  if (pixel >= (float)limit) return limit;
+  return (int)pixel;
+}
+
+// Clips the line to the box around the framebuffer, Liang-Barsky style. Returns
+// false when no part of the line is left
+static bool clip_line(float from[2], float to[2], const float box_min[2], const float box_max[2])
+{
+  float enter_time = 0.0f;
+  float exit_time = 1.0f;
+  for (int axis = 0; axis < 2; axis++)
+  {
+    const float delta = to[axis] - from[axis];
+    if (delta == 0.0f)
+    {
+      if (from[axis] < box_min[axis] || from[axis] > box_max[axis]) return false;
+      continue;
+    }
+
+    float near_time = (box_min[axis] - from[axis]) / delta;
+    float far_time = (box_max[axis] - from[axis]) / delta;
+    if (near_time > far_time)
+    {
+      const float swap = near_time;
+      near_time = far_time;
+      far_time = swap;
+    }
+    if (near_time > enter_time) enter_time = near_time;
+    if (far_time < exit_time) exit_time = far_time;
+    if (enter_time > exit_time) return false;
+  }
+
+  const float delta[2] = { to[0] - from[0], to[1] - from[1] };
+  const float clipped_from[2] = { from[0] + delta[0] * enter_time, from[1] + delta[1] * enter_time };
+  to[0] = from[0] + delta[0] * exit_time;
+  to[1] = from[1] + delta[1] * exit_time;
+  from[0] = clipped_from[0];
+  from[1] = clipped_from[1];
+  return true;
+}
+
+bool framebuffer_create(SFramebuffer * p_framebuffer, int width, int height)
+{
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  p_framebuffer->p_pixels = (width > 0 && height > 0) ? malloc((size_t)width * (size_t)height * 3) : NULL;
+  p_framebuffer->width = p_framebuffer->p_pixels != NULL ? width : 0;
+  p_framebuffer->height = p_framebuffer->p_pixels != NULL ? height : 0;
+
+  return p_framebuffer->p_pixels != NULL;
+}
+
+void framebuffer_destroy(SFramebuffer * p_framebuffer)
+{
+  free(p_framebuffer->p_pixels);
+  *p_framebuffer = (SFramebuffer) { NULL, 0, 0 };
+}
+
+void framebuffer_clear(SFramebuffer * p_framebuffer, SPixelColor color)
+{
+  framebuffer_fill_rect(p_framebuffer, 0.0f, 0.0f, (float)p_framebuffer->width, (float)p_framebuffer->height, color);
+}
+
+void framebuffer_fill_rect(SFramebuffer * p_framebuffer, float min_x, float min_y, float max_x, float max_y, SPixelColor color)
+{
+  const int first_x = first_covered_pixel(min_x, p_framebuffer->width);
+  const int end_x = first_covered_pixel(max_x, p_framebuffer->width);
+  const int first_y = first_covered_pixel(min_y, p_framebuffer->height);
+  const int end_y = first_covered_pixel(max_y, p_framebuffer->height);
+  if (first_x >= end_x) return;
+
+  for (int y = first_y; y < end_y; y++)
+  {
+    uint8_t * p_pixel = p_framebuffer->p_pixels + ((size_t)y * (size_t)p_framebuffer->width + (size_t)first_x) * 3;
+    for (int x = first_x; x < end_x; x++, p_pixel += 3)
+    {
+      p_pixel[0] = color.r;
+      p_pixel[1] = color.g;
+      p_pixel[2] = color.b;
+    }
+  }
+}
+
+void framebuffer_point(SFramebuffer * p_framebuffer, float x, float y, float size, SPixelColor color)
+{
+  const float half_size = size * 0.5f;
+  framebuffer_fill_rect(p_framebuffer, x - half_size, y - half_size, x + half_size, y + half_size, color);
+}
+
+void framebuffer_line(SFramebuffer * p_framebuffer, float from_x, float from_y, float to_x, float to_y, float width, SPixelColor color)
+{
+  // Rays may reach far off screen, only walk the part that can cover pixels
+  float from[2] = { from_x, from_y };
+  float to[2] = { to_x, to_y };
+  const float box_min[2] = { -width, -width };
+  const float box_max[2] = { (float)p_framebuffer->width + width, (float)p_framebuffer->height + width };
+  if (!clip_line(from, to, box_min, box_max)) return;
+
+  // Stamp a square of the line width at every pixel along the major axis
+  const float delta_x = to[0] - from[0];
+  const float delta_y = to[1] - from[1];
+  const float major_length = fabsf(delta_x) > fabsf(delta_y) ? fabsf(delta_x) : fabsf(delta_y);
+  const int steps = (int)ceilf(major_length);
+
+  for (int step = 0; step <= steps; step++)
+  {
+    const float time = steps > 0 ? (float)step / (float)steps : 0.0f;
+    framebuffer_point(p_framebuffer, from[0] + delta_x * time, from[1] + delta_y * time, width, color);
+  }
+}
+
+bool framebuffer_write_ppm(const SFramebuffer * p_framebuffer, const char * p_path)
+{
+  FILE * const p_file = fopen(p_path, "wb");
+  if (p_file == NULL) return false;
+
+  bool written = fprintf(p_file, "P6\n%d %d\n255\n", p_framebuffer->width, p_framebuffer->height) > 0;
+
+  const size_t row_size = (size_t)p_framebuffer->width * 3;
+  for (int y = p_framebuffer->height - 1; written && y >= 0; y--)
+  {
+    written = fwrite(p_framebuffer->p_pixels + (size_t)y * row_size, 1, row_size, p_file) == row_size;
+  }
+
+  return fclose(p_file) == 0 && written;
+}
@@ -0,0 +1,37 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+} SPixelColor;
+
+// RGB image in CPU memory for rendering without a window or GL context. Like the
+// orthographic projection of the demo the origin is at the bottom left, so the
+// same screen coordinates draw the same picture. Rows are stored bottom to top
+typedef struct
+{
+  uint8_t * p_pixels;
+  int width;
+  int height;
+} SFramebuffer;
+
+bool framebuffer_create(SFramebuffer * p_framebuffer, int width, int height);
+void framebuffer_destroy(SFramebuffer * p_framebuffer);
+void framebuffer_clear(SFramebuffer * p_framebuffer, SPixelColor color);
+
+// Shapes cover the pixels whose centers they contain, the way GL rasterizes them,
+// and are clipped to the framebuffer
+void framebuffer_fill_rect(SFramebuffer * p_framebuffer, float min_x, float min_y, float max_x, float max_y, SPixelColor color);
+void framebuffer_point(SFramebuffer * p_framebuffer, float x, float y, float size, SPixelColor color);
+void framebuffer_line(SFramebuffer * p_framebuffer, float from_x, float from_y, float to_x, float to_y, float width, SPixelColor color);
+
+// Writes a binary PPM image, top row first. Returns false when the file could not be written
+bool framebuffer_write_ppm(const SFramebuffer * p_framebuffer, const char * p_path);
+
+#endif
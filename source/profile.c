@@ -0,0 +1,276 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "profile.h"
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define PROFILE_TIME_STAMP_COUNTER
+#include <x86intrin.h>
+#endif
+
+// Records kept, a power of two. Enough for about half a second of the demo
+// casting its whole ray fan with a zone around every ray
+#define PROFILE_RING_CAPACITY 65536
+#define PROFILE_RING_MASK (PROFILE_RING_CAPACITY - 1)
+
+static const char * const counter_names[PROFILE_COUNTER_COUNT] = {
+  "rays_cast",
+  "tiles_stepped",
+  "allocations"
+};
+
+// A record and the one based number of the record in it, zero while it is written
+typedef struct
+{
+  SProfileRecord record;
+  uint64_t sequence;
+} SProfileRingSlot;
+
+static SProfileRingSlot ring[PROFILE_RING_CAPACITY];
+static uint64_t ring_written = 0;
+static bool enabled = false;
+static uint64_t counters[PROFILE_COUNTER_COUNT];
+
+// Ticks and clock read together when profiling was first enabled
+static bool calibrated = false;
+static uint64_t calibration_ticks = 0;
+static uint64_t calibration_ns = 0;
+
+// Small thread numbers for the trace, handed out on the first record of a thread
+static uint32_t threads_seen = 0;
+static __thread uint32_t thread_id = 0;
+
+static uint32_t current_thread_id(void)
+{
+  if (thread_id == 0) thread_id = __atomic_add_fetch(&threads_seen, 1, __ATOMIC_RELAXED);
+  return thread_id;
+}
+
+// Claims the next slot and stamps it with the number of the record once the record
+// is in. Fields are stored one by one as atomics, so readers racing with a write
+// see torn records at worst, which the stamp tells them to skip
+static void record(SProfileRecord profile_record)
+{
+  const uint64_t index = __atomic_fetch_add(&ring_written, 1, __ATOMIC_RELAXED);
+  SProfileRingSlot * const p_slot = &ring[index & PROFILE_RING_MASK];
+
+  __atomic_store_n(&p_slot->sequence, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&p_slot->record.p_name, profile_record.p_name, __ATOMIC_RELAXED);
+  __atomic_store_n(&p_slot->record.start_ticks, profile_record.start_ticks, __ATOMIC_RELAXED);
+  __atomic_store_n(&p_slot->record.value, profile_record.value, __ATOMIC_RELAXED);
+  __atomic_store_n(&p_slot->record.thread_id, profile_record.thread_id, __ATOMIC_RELAXED);
+  __atomic_store_n(&p_slot->record.type, profile_record.type, __ATOMIC_RELAXED);
+  __atomic_store_n(&p_slot->sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+// Copies out the record of the given number. Returns false when its slot holds a
+// record still being written or was already reused for a newer one
+static bool read_record(uint64_t index, SProfileRecord * p_out_record)
+{
+  const SProfileRingSlot * const p_slot = &ring[index & PROFILE_RING_MASK];
+  if (__atomic_load_n(&p_slot->sequence, __ATOMIC_ACQUIRE) != index + 1) return false;
+
+  p_out_record->p_name = __atomic_load_n(&p_slot->record.p_name, __ATOMIC_RELAXED);
+  p_out_record->start_ticks = __atomic_load_n(&p_slot->record.start_ticks, __ATOMIC_RELAXED);
+  p_out_record->value = __atomic_load_n(&p_slot->record.value, __ATOMIC_RELAXED);
+  p_out_record->thread_id = __atomic_load_n(&p_slot->record.thread_id, __ATOMIC_RELAXED);
+  p_out_record->type = __atomic_load_n(&p_slot->record.type, __ATOMIC_RELAXED);
+
+  // A writer that started on the slot meanwhile has cleared the stamp first
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&p_slot->sequence, __ATOMIC_RELAXED) == index + 1;
+}
+
+// Oldest record that may still be in the ring. Records read while other threads
+// record may be unfinished or already overwritten, read_record() skips those
+static uint64_t oldest_record(uint64_t written)
+{
+  return written > PROFILE_RING_CAPACITY ? written - PROFILE_RING_CAPACITY : 0;
+}
+
+// Nanoseconds per tick as measured from the calibration up to now, which gets
+// more precise the longer profiling runs
+static double nanoseconds_per_tick(void)
+{
+#ifdef PROFILE_TIME_STAMP_COUNTER
+  const uint64_t elapsed_ticks = profile_ticks() - calibration_ticks;
+  const uint64_t elapsed_ns = profile_now_ns() - calibration_ns;
+  return elapsed_ticks > 0 ? (double)elapsed_ns / (double)elapsed_ticks : 1.0;
+#else
+  return 1.0;
+#endif
+}
+
+// Ticks of the given time, which may lie before the calibration
+static uint64_t ticks_at_ns(uint64_t time_ns, double ns_per_tick)
+{
+  const double ticks = calibration_ticks + ((double)time_ns - (double)calibration_ns) / ns_per_tick;
+  return ticks > 0.0 ? (uint64_t)ticks : 0;
+}
+
+uint64_t profile_now_ns(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * UINT64_C(1000000000) + (uint64_t)time.tv_nsec;
+}
+
+uint64_t profile_ticks(void)
+{
+#ifdef PROFILE_TIME_STAMP_COUNTER
+  return __rdtsc();
+#else
+  return profile_now_ns();
+#endif
+}
+
+void profile_set_enabled(bool enable)
+{
+  if (enable && !calibrated)
+  {
+    calibration_ticks = profile_ticks();
+    calibration_ns = profile_now_ns();
+    calibrated = true;
+  }
+
+  __atomic_store_n(&enabled, enable, __ATOMIC_RELEASE);
+}
+
+bool profile_enabled(void)
+{
+  return __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+}
+
+SProfileZone profile_zone_open(const char * p_name)
+{
+  // A zone opened while disabled stays unrecorded even if enabled meanwhile
+  return (SProfileZone) { p_name, profile_enabled() ? profile_ticks() : 0 };
+}
+
+void profile_zone_close(SProfileZone * p_zone)
+{
+  if (p_zone->start_ticks == 0) return;
+
+  record((SProfileRecord) { p_zone->p_name, p_zone->start_ticks, profile_ticks() - p_zone->start_ticks, current_thread_id(), PROFILE_RECORD_ZONE });
+}
+
+void profile_count(EProfileCounterType counter, uint64_t amount)
+{
+  __atomic_fetch_add(&counters[counter], amount, __ATOMIC_RELAXED);
+}
+
+uint64_t profile_counter(EProfileCounterType counter)
+{
+  return __atomic_load_n(&counters[counter], __ATOMIC_RELAXED);
+}
+
+void profile_sample_counters(void)
+{
+  if (!profile_enabled()) return;
+
+  const uint64_t now_ticks = profile_ticks();
+  for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++)
+  {
+    record((SProfileRecord) { counter_names[counter], now_ticks, profile_counter(counter), current_thread_id(), PROFILE_RECORD_COUNTER });
+  }
+}
+
+int profile_zone_totals(uint64_t since_ns, SProfileZoneTotal * p_out_totals, int capacity)
+{
+  const uint64_t written = __atomic_load_n(&ring_written, __ATOMIC_ACQUIRE);
+  const double ns_per_tick = nanoseconds_per_tick();
+  const uint64_t since_ticks = ticks_at_ns(since_ns, ns_per_tick);
+  int total_count = 0;
+
+  // Records are in the order their zones ended, so going back in time the first
+  // zone that ended before the given time ends the search
+  for (uint64_t index = written; index > oldest_record(written); index--)
+  {
+    SProfileRecord profile_record;
+    if (!read_record(index - 1, &profile_record)) continue;
+
+    const SProfileRecord * const p_record = &profile_record;
+    if (p_record->type != PROFILE_RECORD_ZONE) continue;
+    if (p_record->start_ticks + p_record->value < since_ticks) break;
+
+    int total = 0;
+    while (total < total_count && p_out_totals[total].p_name != p_record->p_name) total++;
+    if (total == total_count)
+    {
+      if (total_count == capacity) continue;
+      p_out_totals[total_count++] = (SProfileZoneTotal) { p_record->p_name, 0, 0 };
+    }
+
+    p_out_totals[total].total_ns += p_record->value;
+    p_out_totals[total].zone_count++;
+  }
+
+  // Summed up in ticks, converted once
+  for (int total = 0; total < total_count; total++)
+  {
+    p_out_totals[total].total_ns = (uint64_t)(p_out_totals[total].total_ns * ns_per_tick);
+  }
+
+  return total_count;
+}
+
+bool profile_write_chrome_trace(const char * p_path)
+{
+  FILE * const p_file = fopen(p_path, "w");
+  if (p_file == NULL) return false;
+
+  const uint64_t written = __atomic_load_n(&ring_written, __ATOMIC_ACQUIRE);
+  const uint64_t oldest = oldest_record(written);
+  const double us_per_tick = nanoseconds_per_tick() * 1e-3;
+
+  // Timestamps in microseconds from the oldest record, which keeps them short
+  uint64_t base_ticks = UINT64_MAX;
+  for (uint64_t index = oldest; index < written; index++)
+  {
+    SProfileRecord profile_record;
+    if (read_record(index, &profile_record) && profile_record.start_ticks < base_ticks) base_ticks = profile_record.start_ticks;
+  }
+
+  // Records skipped above as unfinished may start before the base, clamp them
+  fprintf(p_file, "{\"traceEvents\":[");
+  const char * p_separator = "\n";
+  for (uint64_t index = oldest; index < written; index++)
+  {
+    SProfileRecord profile_record;
+    if (!read_record(index, &profile_record)) continue;
+
+    const SProfileRecord * const p_record = &profile_record;
+    const double timestamp_us = p_record->start_ticks > base_ticks ? (p_record->start_ticks - base_ticks) * us_per_tick : 0.0;
+
+    if (p_record->type == PROFILE_RECORD_ZONE)
+    {
+      fprintf(
+        p_file,
+        "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+        p_separator,
+        p_record->p_name,
+        timestamp_us,
+        p_record->value * us_per_tick,
+        p_record->thread_id
+      );
+    }
+    else
+    {
+      fprintf(
+        p_file,
+        "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%llu}}",
+        p_separator,
+        p_record->p_name,
+        timestamp_us,
+        (unsigned long long)p_record->value
+      );
+    }
+    p_separator = ",\n";
+  }
+  fprintf(p_file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+  const bool written_completely = !ferror(p_file);
+  return fclose(p_file) == 0 && written_completely;
+}
@@ -0,0 +1,96 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scoped timing zones and event counters for finding where the time of a frame
+// goes. Zones and counters only exist in builds with RAYCAST_PROFILE defined,
+// every other build compiles them to nothing. Zones are only recorded while
+// profiling is enabled at runtime, counters always count
+
+typedef enum
+{
+  // Rays cast by the enumerating and first hit raycasts
+  PROFILE_COUNTER_RAYS_CAST,
+  // Tiles entered by the enumerating raycasts
+  PROFILE_COUNTER_TILES_STEPPED,
+  // Heap allocations made by the library and the demo
+  PROFILE_COUNTER_ALLOCATIONS,
+  PROFILE_COUNTER_COUNT
+} EProfileCounterType;
+
+typedef enum
+{
+  PROFILE_RECORD_ZONE,
+  PROFILE_RECORD_COUNTER
+} EProfileRecordType;
+
+// One finished zone or one counter sample. Names are never copied, they have to
+// be string literals. Times are in profile ticks, see profile_ticks()
+typedef struct
+{
+  const char * p_name;
+  uint64_t start_ticks;
+  // Zone duration in ticks or counter value
+  uint64_t value;
+  uint32_t thread_id;
+  EProfileRecordType type;
+} SProfileRecord;
+
+// Time spent in all zones of one name
+typedef struct
+{
+  const char * p_name;
+  uint64_t total_ns;
+  int zone_count;
+} SProfileZoneTotal;
+
+typedef struct
+{
+  const char * p_name;
+  uint64_t start_ticks;
+} SProfileZone;
+
+uint64_t profile_now_ns(void);
+
+// The time stamp counter on x86-64, which is about twice as cheap to read as the
+// monotonic clock, and nanoseconds elsewhere. Ticks are converted to nanoseconds
+// only when the records are read, against the clock since profiling was enabled
+uint64_t profile_ticks(void);
+
+// Records go into one ring shared by all threads, the oldest records are overwritten
+void profile_set_enabled(bool enable);
+bool profile_enabled(void);
+
+SProfileZone profile_zone_open(const char * p_name);
+void profile_zone_close(SProfileZone * p_zone);
+
+void profile_count(EProfileCounterType counter, uint64_t amount);
+uint64_t profile_counter(EProfileCounterType counter);
+
+// Records the current value of every counter, so traces can plot them over time
+void profile_sample_counters(void);
+
+// Sums the zones that ended at or after the given time per name, in the order
+// the names were first seen going back in time. Returns the number of names
+int profile_zone_totals(uint64_t since_ns, SProfileZoneTotal * p_out_totals, int capacity);
+
+// Writes every record in the ring as Chrome trace event JSON, which loads in
+// chrome://tracing and Perfetto. Returns false when the file could not be written
+bool profile_write_chrome_trace(const char * p_path);
+
+#ifdef RAYCAST_PROFILE
+#define PROFILE_CONCATENATE_EXPANDED(left, right) left##right
+#define PROFILE_CONCATENATE(left, right) PROFILE_CONCATENATE_EXPANDED(left, right)
+
+// Times the rest of the enclosing block
+#define PROFILE_ZONE(name) \
+  SProfileZone PROFILE_CONCATENATE(profile_zone_, __LINE__) __attribute__((cleanup(profile_zone_close))) = profile_zone_open(name)
+#define PROFILE_COUNT(counter, amount) profile_count(counter, amount)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#endif
+
+#endif
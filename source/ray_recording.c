@@ -0,0 +1,244 @@
+#include "ray_recording.h"
+#include <string.h>
+
+#define RECORDING_MAGIC "GRRC"
+#define RECORDING_VERSION 1
+
+// Magic, version and the grid origin, tile dimensions and tiles per axis
+#define HEADER_SIZE (4 + 4 + 6 * 4)
+
+// Type, origin, vector, impact capacity, result, impact count and checksum
+#define RAY_ENTRY_SIZE (1 + 4 * 4 + 4 + 1 + 4 + 8)
+
+// Type, tile and solidity
+#define TILE_ENTRY_SIZE (1 + 2 * 4 + 1)
+
+#define CHECKSUM_OFFSET_BASIS UINT64_C(0xCBF29CE484222325)
+#define CHECKSUM_PRIME UINT64_C(0x100000001B3)
+
+static uint32_t float_bits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bits_float(uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static unsigned char * put_u32(unsigned char * p_bytes, uint32_t value)
+{
+  for (int byte = 0; byte < 4; byte++) p_bytes[byte] = (unsigned char)(value >> (8 * byte));
+  return p_bytes + 4;
+}
+
+static unsigned char * put_u64(unsigned char * p_bytes, uint64_t value)
+{
+  for (int byte = 0; byte < 8; byte++) p_bytes[byte] = (unsigned char)(value >> (8 * byte));
+  return p_bytes + 8;
+}
+
+static const unsigned char * get_u32(const unsigned char * p_bytes, uint32_t * p_value)
+{
+  *p_value = 0;
+  for (int byte = 0; byte < 4; byte++) *p_value |= (uint32_t)p_bytes[byte] << (8 * byte);
+  return p_bytes + 4;
+}
+
+static const unsigned char * get_u64(const unsigned char * p_bytes, uint64_t * p_value)
+{
+  *p_value = 0;
+  for (int byte = 0; byte < 8; byte++) *p_value |= (uint64_t)p_bytes[byte] << (8 * byte);
+  return p_bytes + 8;
+}
+
+static const unsigned char * get_i32(const unsigned char * p_bytes, int * p_value)
+{
+  uint32_t bits;
+  p_bytes = get_u32(p_bytes, &bits);
+  *p_value = (int)(int32_t)bits;
+  return p_bytes;
+}
+
+static const unsigned char * get_f32(const unsigned char * p_bytes, float * p_value)
+{
+  uint32_t bits;
+  p_bytes = get_u32(p_bytes, &bits);
+  *p_value = bits_float(bits);
+  return p_bytes;
+}
+
+// FNV-1a over the four bytes of the word
+static uint64_t checksum_word(uint64_t checksum, uint32_t word)
+{
+  for (int byte = 0; byte < 4; byte++) checksum = (checksum ^ ((word >> (8 * byte)) & 0xFF)) * CHECKSUM_PRIME;
+  return checksum;
+}
+
+uint64_t ray_recording_checksum(const SImpactInformation * p_impacts, int impact_count)
+{
+  uint64_t checksum = CHECKSUM_OFFSET_BASIS;
+  for (int impact_index = 0; impact_index < impact_count; impact_index++)
+  {
+    const SImpactInformation * const p_impact = &p_impacts[impact_index];
+    checksum = checksum_word(checksum, float_bits(p_impact->impact_time));
+    checksum = checksum_word(checksum, float_bits(p_impact->impact_point.x));
+    checksum = checksum_word(checksum, float_bits(p_impact->impact_point.y));
+    checksum = checksum_word(checksum, (uint32_t)p_impact->impact_tile.x);
+    checksum = checksum_word(checksum, (uint32_t)p_impact->impact_tile.y);
+    checksum = checksum_word(checksum, (uint32_t)p_impact->impact_normal.x);
+    checksum = checksum_word(checksum, (uint32_t)p_impact->impact_normal.y);
+    checksum = checksum_word(checksum, float_bits(p_impact->exit_time));
+  }
+
+  return checksum;
+}
+
+void ray_recording_set_result(SRayRecordingEntry * p_entry, ERaycastResultType result, const SImpactInformation * p_impacts, int impact_count)
+{
+  p_entry->result = result;
+  p_entry->impact_count = (uint32_t)impact_count;
+  p_entry->impact_checksum = ray_recording_checksum(p_impacts, impact_count);
+}
+
+bool ray_recording_writer_open(SRayRecordingWriter * p_writer, const char * p_path, const SGrid * p_grid)
+{
+  *p_writer = (SRayRecordingWriter) { fopen(p_path, "wb"), false };
+  if (p_writer->p_file == NULL) return false;
+
+  unsigned char header[HEADER_SIZE];
+  memcpy(header, RECORDING_MAGIC, 4);
+  unsigned char * p_bytes = put_u32(header + 4, RECORDING_VERSION);
+  p_bytes = put_u32(p_bytes, (uint32_t)p_grid->origin_bottom_left.x);
+  p_bytes = put_u32(p_bytes, (uint32_t)p_grid->origin_bottom_left.y);
+  p_bytes = put_u32(p_bytes, (uint32_t)p_grid->tile_dimensions.x);
+  p_bytes = put_u32(p_bytes, (uint32_t)p_grid->tile_dimensions.y);
+  p_bytes = put_u32(p_bytes, (uint32_t)p_grid->tiles_on_axis.x);
+  put_u32(p_bytes, (uint32_t)p_grid->tiles_on_axis.y);
+
+  p_writer->failed = fwrite(header, 1, sizeof(header), p_writer->p_file) != sizeof(header);
+  return true;
+}
+
+void ray_recording_write(SRayRecordingWriter * p_writer, const SRayRecordingEntry * p_entry)
+{
+  unsigned char entry[RAY_ENTRY_SIZE];
+  entry[0] = (unsigned char)p_entry->type;
+
+  size_t entry_size = RAY_ENTRY_SIZE;
+  if (p_entry->type == RAY_RECORDING_SET_TILE)
+  {
+    unsigned char * const p_bytes = put_u32(put_u32(entry + 1, (uint32_t)p_entry->tile.x), (uint32_t)p_entry->tile.y);
+    *p_bytes = p_entry->solid ? 1 : 0;
+    entry_size = TILE_ENTRY_SIZE;
+  }
+  else
+  {
+    unsigned char * p_bytes = put_u32(entry + 1, float_bits(p_entry->origin.x));
+    p_bytes = put_u32(p_bytes, float_bits(p_entry->origin.y));
+    p_bytes = put_u32(p_bytes, float_bits(p_entry->vector.x));
+    p_bytes = put_u32(p_bytes, float_bits(p_entry->vector.y));
+    p_bytes = put_u32(p_bytes, p_entry->impact_capacity);
+    *p_bytes++ = (unsigned char)p_entry->result;
+    p_bytes = put_u32(p_bytes, p_entry->impact_count);
+    put_u64(p_bytes, p_entry->impact_checksum);
+  }
+
+  if (fwrite(entry, 1, entry_size, p_writer->p_file) != entry_size) p_writer->failed = true;
+}
+
+bool ray_recording_writer_close(SRayRecordingWriter * p_writer)
+{
+  const bool closed = fclose(p_writer->p_file) == 0;
+  p_writer->p_file = NULL;
+
+  return closed && !p_writer->failed;
+}
+
+bool ray_recording_reader_open(SRayRecordingReader * p_reader, const char * p_path)
+{
+  *p_reader = (SRayRecordingReader) { fopen(p_path, "rb"), { { 0, 0 }, { 0, 0 }, { 0, 0 } } };
+  if (p_reader->p_file == NULL) return false;
+
+  unsigned char header[HEADER_SIZE];
+  uint32_t version = 0;
+  const bool header_read = fread(header, 1, sizeof(header), p_reader->p_file) == sizeof(header);
+  if (header_read) get_u32(header + 4, &version);
+
+  if (!header_read || memcmp(header, RECORDING_MAGIC, 4) != 0 || version != RECORDING_VERSION)
+  {
+    ray_recording_reader_close(p_reader);
+    return false;
+  }
+
+  const unsigned char * p_bytes = get_i32(header + 8, &p_reader->grid.origin_bottom_left.x);
+  p_bytes = get_i32(p_bytes, &p_reader->grid.origin_bottom_left.y);
+  p_bytes = get_i32(p_bytes, &p_reader->grid.tile_dimensions.x);
+  p_bytes = get_i32(p_bytes, &p_reader->grid.tile_dimensions.y);
+  p_bytes = get_i32(p_bytes, &p_reader->grid.tiles_on_axis.x);
+  get_i32(p_bytes, &p_reader->grid.tiles_on_axis.y);
+
+  const SGrid * const p_grid = &p_reader->grid;
+  if (p_grid->tile_dimensions.x <= 0 || p_grid->tile_dimensions.y <= 0 || p_grid->tiles_on_axis.x <= 0 || p_grid->tiles_on_axis.y <= 0)
+  {
+    ray_recording_reader_close(p_reader);
+    return false;
+  }
+
+  return true;
+}
+
+ERayRecordingReadType ray_recording_read(SRayRecordingReader * p_reader, SRayRecordingEntry * p_out_entry)
+{
+  unsigned char entry[RAY_ENTRY_SIZE];
+  if (fread(entry, 1, 1, p_reader->p_file) != 1) return RAY_RECORDING_READ_END;
+
+  *p_out_entry = (SRayRecordingEntry) { .type = (ERayRecordingEntryType)entry[0] };
+  switch (p_out_entry->type)
+  {
+    case RAY_RECORDING_SET_TILE:
+    {
+      if (fread(entry + 1, 1, TILE_ENTRY_SIZE - 1, p_reader->p_file) != TILE_ENTRY_SIZE - 1) return RAY_RECORDING_READ_CORRUPT;
+
+      const unsigned char * const p_bytes = get_i32(get_i32(entry + 1, &p_out_entry->tile.x), &p_out_entry->tile.y);
+      p_out_entry->solid = *p_bytes != 0;
+      return RAY_RECORDING_READ_ENTRY;
+    }
+
+    case RAY_RECORDING_ENUMERATE:
+    case RAY_RECORDING_FIRST_HIT:
+    {
+      if (fread(entry + 1, 1, RAY_ENTRY_SIZE - 1, p_reader->p_file) != RAY_ENTRY_SIZE - 1) return RAY_RECORDING_READ_CORRUPT;
+
+      const unsigned char * p_bytes = get_f32(entry + 1, &p_out_entry->origin.x);
+      p_bytes = get_f32(p_bytes, &p_out_entry->origin.y);
+      p_bytes = get_f32(p_bytes, &p_out_entry->vector.x);
+      p_bytes = get_f32(p_bytes, &p_out_entry->vector.y);
+      p_bytes = get_u32(p_bytes, &p_out_entry->impact_capacity);
+      p_out_entry->result = (ERaycastResultType)*p_bytes++;
+      p_bytes = get_u32(p_bytes, &p_out_entry->impact_count);
+      get_u64(p_bytes, &p_out_entry->impact_checksum);
+
+      // First hits report at most the one impact, enumerations at most their capacity
+      const uint32_t max_impact_count = p_out_entry->type == RAY_RECORDING_FIRST_HIT ? 1 : p_out_entry->impact_capacity;
+      const bool valid =
+        p_out_entry->impact_capacity <= RAY_RECORDING_MAX_IMPACT_CAPACITY &&
+        p_out_entry->result <= RAYCAST_OCCUPANCY_MISMATCH &&
+        p_out_entry->impact_count <= max_impact_count;
+      return valid ? RAY_RECORDING_READ_ENTRY : RAY_RECORDING_READ_CORRUPT;
+    }
+
+    default:
+      return RAY_RECORDING_READ_CORRUPT;
+  }
+}
+
+void ray_recording_reader_close(SRayRecordingReader * p_reader)
+{
+  fclose(p_reader->p_file);
+  p_reader->p_file = NULL;
+}
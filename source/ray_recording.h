@@ -0,0 +1,82 @@
+#ifndef RAY_RECORDING_H
+#define RAY_RECORDING_H
+
+#include "raycast.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Compact binary log of the rays cast against one grid, along with the tile
+// changes in between and the result every ray had when it was recorded, so the
+// same workload can be replayed later and checked against that reference.
+// Everything is stored little endian, floats by their exact bits
+
+// Largest impact capacity a ray entry may ask for, replays allocate a buffer of the
+// largest capacity in the recording up front
+#define RAY_RECORDING_MAX_IMPACT_CAPACITY (1 << 20)
+
+typedef enum
+{
+  // A raycast_grid() into a buffer of the recorded capacity
+  RAY_RECORDING_ENUMERATE,
+  // A raycast_first_hit() against the tiles set so far
+  RAY_RECORDING_FIRST_HIT,
+  RAY_RECORDING_SET_TILE
+} ERayRecordingEntryType;
+
+typedef struct
+{
+  ERayRecordingEntryType type;
+  // Rays only
+  SVec2f origin;
+  SVec2f vector;
+  uint32_t impact_capacity;
+  ERaycastResultType result;
+  uint32_t impact_count;
+  uint64_t impact_checksum;
+  // Tile changes only
+  SVec2i tile;
+  bool solid;
+} SRayRecordingEntry;
+
+typedef enum
+{
+  RAY_RECORDING_READ_ENTRY,
+  RAY_RECORDING_READ_END,
+  // A truncated entry, one of an unknown type or one whose impact capacity, result
+  // or impact count no raycast produces. Nothing after it can be read
+  RAY_RECORDING_READ_CORRUPT
+} ERayRecordingReadType;
+
+typedef struct
+{
+  FILE * p_file;
+  bool failed;
+} SRayRecordingWriter;
+
+typedef struct
+{
+  FILE * p_file;
+  SGrid grid;
+} SRayRecordingReader;
+
+// Checksum over the exact bits of every field of the impacts. Equal checksums
+// mean equal impacts for all practical purposes
+uint64_t ray_recording_checksum(const SImpactInformation * p_impacts, int impact_count);
+
+// Fills in the reference result of a ray entry from what the raycast returned
+void ray_recording_set_result(SRayRecordingEntry * p_entry, ERaycastResultType result, const SImpactInformation * p_impacts, int impact_count);
+
+bool ray_recording_writer_open(SRayRecordingWriter * p_writer, const char * p_path, const SGrid * p_grid);
+void ray_recording_write(SRayRecordingWriter * p_writer, const SRayRecordingEntry * p_entry);
+
+// Returns false when any entry could not be written
+bool ray_recording_writer_close(SRayRecordingWriter * p_writer);
+
+// Returns false when the file is missing, is no recording of a known version or its
+// grid has no tiles
+bool ray_recording_reader_open(SRayRecordingReader * p_reader, const char * p_path);
+ERayRecordingReadType ray_recording_read(SRayRecordingReader * p_reader, SRayRecordingEntry * p_out_entry);
+void ray_recording_reader_close(SRayRecordingReader * p_reader);
+
+#endif
@@ -0,0 +1,527 @@
+#include "raycast.h"
+#include "raycast_traversal.h"
+#include "helpers.h"
+#include "profile.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stddef.h>
+#include <limits.h>
+
+// C99 has no alignof - The offset of a member following a single char is its alignment
+#define IMPACT_INFORMATION_ALIGNMENT offsetof(struct { char c; SImpactInformation impact; }, impact)
+
+SVec2i raycast_grid_dimensions(const SGrid * p_grid)
+{
+  return (SVec2i) {
+    p_grid->tiles_on_axis.x * p_grid->tile_dimensions.x,
+    p_grid->tiles_on_axis.y * p_grid->tile_dimensions.y
+  };
+}
+
+SAABB4f raycast_grid_bounding_box(const SGrid * p_grid)
+{
+  // Grids of millions of tiles exceed int pixel coordinates, so sum up in double
+  return (SAABB4f) {
+    { p_grid->origin_bottom_left.x, p_grid->origin_bottom_left.y },
+    {
+      (float)(p_grid->origin_bottom_left.x + (double)p_grid->tiles_on_axis.x * p_grid->tile_dimensions.x),
+      (float)(p_grid->origin_bottom_left.y + (double)p_grid->tiles_on_axis.y * p_grid->tile_dimensions.y)
+    }
+  };
+}
+
+static int sort_impact_information(const void * info_left, const void * info_right)
+{
+  const SImpactInformation * p_info_left = (const SImpactInformation *)info_left;
+  const SImpactInformation * p_info_right = (const SImpactInformation *)info_right;
+
+  if (p_info_left->impact_time < p_info_right->impact_time)
+    return -1;
+  else if (p_info_left->impact_time > p_info_right->impact_time)
+    return 1;
+  else
+    return 0;
+}
+
+static bool record_impact(SImpactBuffer * p_buffer, SImpactInformation impact)
+{
+  if (p_buffer->count == p_buffer->capacity) return false;
+
+  p_buffer->p_impacts[p_buffer->count++] = impact;
+  return true;
+}
+
+static bool point_out_of_bounds(SAABB4f bounding_box, SVec2f point)
+{
+  return
+    point.x < bounding_box.min.x ||
+    point.x > bounding_box.max.x ||
+    point.y < bounding_box.min.y ||
+    point.y > bounding_box.max.y;
+}
+
+ERaycastResultType raycast_grid_arena
+(
+  const SGrid * p_grid,
+  SVec2f origin,
+  SVec2f vector,
+  SFrameArena * p_arena,
+  SImpactBuffer * p_out_span
+)
+{
+  // Let the raycast fill all the remaining arena memory, then give back what is unused
+  size_t reserved_size;
+  SImpactInformation * const p_reservation =
+    frame_arena_reserve_remaining(p_arena, IMPACT_INFORMATION_ALIGNMENT, &reserved_size);
+
+  const size_t reserved_impacts = reserved_size / sizeof(SImpactInformation);
+  SImpactBuffer reserved_buffer = {
+    p_reservation,
+    reserved_impacts > INT_MAX ? INT_MAX : (int)reserved_impacts,
+    0
+  };
+  const ERaycastResultType result = raycast_grid(p_grid, origin, vector, &reserved_buffer);
+
+  if (p_reservation != NULL)
+    frame_arena_commit(p_arena, p_reservation, sizeof(SImpactInformation) * reserved_buffer.count);
+
+  *p_out_span = (SImpactBuffer) { p_reservation, reserved_buffer.count, reserved_buffer.count };
+  return result;
+}
+
+ERaycastResultType raycast_grid_per_axis
+(
+  const SGrid * p_grid,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactBuffer * p_out_buffer
+)
+{
+  p_out_buffer->count = 0;
+
+  const SVec2i grid_origin = p_grid->origin_bottom_left;
+  const SVec2i tile_dimensions = p_grid->tile_dimensions;
+  const SVec2i grid_dimensions = raycast_grid_dimensions(p_grid);
+  const SAABB4f grid_bounding_box = raycast_grid_bounding_box(p_grid);
+
+  // Start computing all impact points
+  const SVec2f raycast_grid_relative_origin = {
+    (origin.x - grid_origin.x),
+    (origin.y - grid_origin.y)
+  };
+
+  // Consider raycast only when ray origin inside the grid
+  const bool ray_origin_out_of_grid_bounds =
+    (raycast_grid_relative_origin.x < 0.0f)               ||
+    (raycast_grid_relative_origin.x >= grid_dimensions.x) ||
+    (raycast_grid_relative_origin.y < 0.0f)               ||
+    (raycast_grid_relative_origin.y >= grid_dimensions.y);
+
+  if (ray_origin_out_of_grid_bounds) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  // Both axis record straight into the callers buffer, which is sorted once done
+  bool buffer_exhausted = false;
+
+  // Determine first impact point between the ray and the tile it is contained in based
+  // on the ray direction and the first edge the ray impacts for each axis
+  const SVec2i raycast_tile_origin = {
+    (int)(raycast_grid_relative_origin.x / tile_dimensions.x),
+    (int)(raycast_grid_relative_origin.y / tile_dimensions.y)
+  };
+  const SVec2i raycast_direction = helper_vector_direction(vector);
+
+  // When the ray is positive (x or y axis) it must be swept against the right tile
+  // edge, if it is negative (x or y axis) it must be swept against the left tile edge
+  const SVec2i tile_edge_in_ray_direction = {
+    raycast_direction.x > 0 ? (raycast_tile_origin.x + raycast_direction.x) * tile_dimensions.x : raycast_tile_origin.x * tile_dimensions.x,
+    raycast_direction.y > 0 ? (raycast_tile_origin.y + raycast_direction.y) * tile_dimensions.y : raycast_tile_origin.y * tile_dimensions.y,
+  };
+
+  // Determine impact time between the ray vector and the tile containing the origin
+  // Beware of ray vector axis parallel to any grid axis
+  const SVec2f intersect_times_initial = {
+    (tile_edge_in_ray_direction.x - raycast_grid_relative_origin.x) / vector.x,
+    (tile_edge_in_ray_direction.y - raycast_grid_relative_origin.y) / vector.y
+  };
+
+  // Determine if the ray hits the edge and if, at what exact position
+  const SVec2b initial_ray_hits = {
+    raycast_direction.x != 0 && intersect_times_initial.x < 1.0f,
+    raycast_direction.y != 0 && intersect_times_initial.y < 1.0f,
+  };
+
+  // First edge on each axis not recorded, where the tile of the last impact is left
+  SVec2f next_crossing_times = {
+    raycast_direction.x != 0 ? intersect_times_initial.x : INFINITY,
+    raycast_direction.y != 0 ? intersect_times_initial.y : INFINITY
+  };
+
+  // Step through all impact points for vertical tile edges
+  if (raycast_direction.x != 0 && initial_ray_hits.x == true)
+  {
+    // Note: We know the x axis of the ray hit the vertical tile edge containing the ray origin
+    SVec2f initial_impact_position_raycast_x = {
+      origin.x + vector.x * intersect_times_initial.x,
+      origin.y + vector.y * intersect_times_initial.x
+    };
+
+    if (!point_out_of_bounds(grid_bounding_box, initial_impact_position_raycast_x))
+    {
+      // Determine which tile the impact hits
+      SVec2i tiled_impact_point = {
+        tile_edge_in_ray_direction.x / tile_dimensions.x,
+        (initial_impact_position_raycast_x.y - grid_origin.y) / tile_dimensions.y
+      };
+      SVec2i impacted_tile_based_on_ray = {
+        vector.x >= 0 ? tiled_impact_point.x : tiled_impact_point.x - 1,
+        tiled_impact_point.y
+      };
+
+      // Record initial impact on vertical edge
+      buffer_exhausted |= !record_impact(p_out_buffer, (SImpactInformation) {
+        intersect_times_initial.x,
+        initial_impact_position_raycast_x,
+        impacted_tile_based_on_ray,
+        { -raycast_direction.x, 0 },
+        0.0f
+      });
+
+      // Note: We know the vertical edge hit is in bound of the grid
+      // Now determine all subsequent impacts on the vertical edges
+      //
+      // Do not accumulate the distances but rather determine the required lengths to avoid rounding errors
+      // over large raycast distances
+      int step_index = 1;
+      const float horizontal_edge_stepsize = fabs((vector.y * tile_dimensions.x) / vector.x);
+      const SVec2f step_size = { tile_dimensions.x * raycast_direction.x, horizontal_edge_stepsize * raycast_direction.y };
+
+      // Work in parametric time along the ray - Each edge on this axis is the same
+      // time apart, so the impact time of any step is the initial time plus the
+      // step index times that constant, which needs neither a length nor a sqrt
+      const float intersect_time_per_tile = tile_dimensions.x / fabsf(vector.x);
+
+      // Add points on vertical tile edges to list until out of grid bounds or ray length overshot
+      while (true) {
+        // Compute the impact point for the current step based on the initial impact
+        // The step size is always the same for a given axis, so the triangle edges can be
+        // determined from the grid tilesize and the ration of the raycast vector component lengths
+        const SVec2f stepped_edge_impact = {
+          initial_impact_position_raycast_x.x + step_size.x * step_index,
+          initial_impact_position_raycast_x.y + step_size.y * step_index
+        };
+
+        // Stop stepping and ignore next impact point when the impact is out of grid bounds
+        if (point_out_of_bounds(grid_bounding_box, stepped_edge_impact)) break;
+
+        // Stop stepping and ignore next impact point when the impact is further than the ray can reach
+        const float stepped_edge_impact_time = intersect_times_initial.x + intersect_time_per_tile * step_index;
+        if (!(stepped_edge_impact_time <= 1.0f)) break;
+
+        // Determine which tile the impact hits
+        SVec2i tiled_impact_point = {
+          (stepped_edge_impact.x - grid_origin.x) / tile_dimensions.x,
+          (stepped_edge_impact.y - grid_origin.y) / tile_dimensions.y
+        };
+        SVec2i impacted_tile_based_on_ray = {
+          vector.x >= 0 ? tiled_impact_point.x : tiled_impact_point.x - 1,
+          tiled_impact_point.y
+        };
+
+        // Record the stepped impact point to the list of vertical impacts for the raycast x component
+        buffer_exhausted |= !record_impact(p_out_buffer, (SImpactInformation) {
+          stepped_edge_impact_time,
+          stepped_edge_impact,
+          impacted_tile_based_on_ray,
+          { -raycast_direction.x, 0 },
+          0.0f
+        });
+
+        // Prepare for the next step
+        step_index++;
+      }
+      next_crossing_times.x = intersect_times_initial.x + intersect_time_per_tile * step_index;
+    }
+  }
+
+  // Step through all impact points for horizontal tile edges
+  if (raycast_direction.y != 0 && initial_ray_hits.y == true)
+  {
+    // Note: We know the y axis of the ray hit the horizontal tile edge containing the ray origin
+    SVec2f initial_impact_position_raycast_y = {
+      origin.x + vector.x * intersect_times_initial.y,
+      origin.y + vector.y * intersect_times_initial.y
+    };
+
+    if (!point_out_of_bounds(grid_bounding_box, initial_impact_position_raycast_y))
+    {
+      // Determine which tile the impact hits
+      SVec2i tiled_impact_point = {
+        (initial_impact_position_raycast_y.x - grid_origin.x) / tile_dimensions.x,
+        tile_edge_in_ray_direction.y / tile_dimensions.y
+      };
+      SVec2i impacted_tile_based_on_ray = {
+        tiled_impact_point.x,
+        vector.y >= 0 ? tiled_impact_point.y : tiled_impact_point.y - 1
+      };
+
+      // Record initial impact on vertical edge
+      buffer_exhausted |= !record_impact(p_out_buffer, (SImpactInformation) {
+        intersect_times_initial.y,
+        initial_impact_position_raycast_y,
+        impacted_tile_based_on_ray,
+        { 0, -raycast_direction.y },
+        0.0f
+      });
+
+      // Note: We know the horizontal edge hit is in bound of the grid
+      // Now determine all subsequent impacts on the horizontal edges
+      //
+      // Do not accumulate the distances but rather determine the required lengths to avoid rounding errors
+      // over large raycast distances
+      int step_index = 1;
+      const float vertical_edge_stepsize = fabs((vector.x * tile_dimensions.y) / vector.y);
+      const SVec2f step_size = { vertical_edge_stepsize * raycast_direction.x, tile_dimensions.y * raycast_direction.y };
+
+      // Same parametric time stepping as for the vertical edges
+      const float intersect_time_per_tile = tile_dimensions.y / fabsf(vector.y);
+
+      // Add points on horizontal tile edges to list until out of grid bounds or ray length overshot
+      while (true) {
+        // Compute the impact point for the current step based on the initial impact
+        // The step size is always the same for a given axis, so the triangle edges can be
+        // determined from the grid tilesize and the ration of the raycast vector component lengths
+        const SVec2f stepped_edge_impact = {
+          initial_impact_position_raycast_y.x + step_size.x * step_index,
+          initial_impact_position_raycast_y.y + step_size.y * step_index
+        };
+
+        // Stop stepping and ignore next impact point when the impact is out of grid bounds
+        if (point_out_of_bounds(grid_bounding_box, stepped_edge_impact)) break;
+
+        // Stop stepping and ignore next impact point when the impact is further than the ray can reach
+        const float stepped_edge_impact_time = intersect_times_initial.y + intersect_time_per_tile * step_index;
+        if (!(stepped_edge_impact_time <= 1.0f)) break;
+
+        // Determine which tile the impact hits
+        SVec2i tiled_impact_point = {
+          (stepped_edge_impact.x - grid_origin.x) / tile_dimensions.x,
+          (stepped_edge_impact.y - grid_origin.y) / tile_dimensions.y
+        };
+        SVec2i impacted_tile_based_on_ray = {
+          tiled_impact_point.x,
+          vector.y >= 0 ? tiled_impact_point.y : tiled_impact_point.y - 1
+        };
+
+        // Record the stepped impact point to the list of horizontal impacts for the raycast x component
+        buffer_exhausted |= !record_impact(p_out_buffer, (SImpactInformation) {
+          stepped_edge_impact_time,
+          stepped_edge_impact,
+          impacted_tile_based_on_ray,
+          { 0, -raycast_direction.y },
+          0.0f
+        });
+
+        // Prepare for the next step
+        step_index++;
+      }
+      next_crossing_times.y = intersect_times_initial.y + intersect_time_per_tile * step_index;
+    }
+  }
+
+  // Sort the impacts of both axis by time
+  // Are there any duplicates to worry about? If so, what is the causing edge-case?
+  qsort(p_out_buffer->p_impacts, p_out_buffer->count, sizeof(SImpactInformation), sort_impact_information);
+
+  // Every tile is left where the next one is entered, the last one where the next
+  // edge would have been crossed or the ray ends
+  const float last_exit_time = fminf(fminf(next_crossing_times.x, next_crossing_times.y), 1.0f);
+  for (int impact = 0; impact < p_out_buffer->count; impact++)
+  {
+    p_out_buffer->p_impacts[impact].exit_time =
+      impact + 1 < p_out_buffer->count ? p_out_buffer->p_impacts[impact + 1].impact_time : last_exit_time;
+  }
+
+  return buffer_exhausted ? RAYCAST_BUFFER_EXHAUSTED : RAYCAST_SUCCESS;
+}
+
+// Fails to compile when the traversal outgrows the cursor state
+typedef char cursor_state_holds_traversal[sizeof(SRaycastTraversal) <= RAYCAST_CURSOR_STATE_SIZE ? 1 : -1];
+
+static SRaycastTraversal * cursor_traversal(SRaycastCursor * p_cursor)
+{
+  return (SRaycastTraversal *)p_cursor->state.bytes;
+}
+
+ERaycastResultType raycast_begin(SRaycastCursor * p_cursor, const SGrid * p_grid, SVec2f origin, SVec2f vector)
+{
+  PROFILE_COUNT(PROFILE_COUNTER_RAYS_CAST, 1);
+  if (!raycast_traversal_begin(cursor_traversal(p_cursor), p_grid, origin, vector)) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+  return RAYCAST_SUCCESS;
+}
+
+bool raycast_next(SRaycastCursor * p_cursor, SImpactInformation * p_out_impact)
+{
+  SRaycastTraversal * const p_traversal = cursor_traversal(p_cursor);
+  if (!raycast_traversal_step(p_traversal, p_out_impact)) return false;
+
+  p_out_impact->exit_time = raycast_traversal_exit_time(p_traversal);
+  return true;
+}
+
+SVec2i raycast_cursor_tile(const SRaycastCursor * p_cursor)
+{
+  return ((const SRaycastTraversal *)p_cursor->state.bytes)->current_tile;
+}
+
+static inline __attribute__((always_inline)) ERaycastResultType grid_toward
+(
+  SRaycastTraversal * p_traversal,
+  SImpactBuffer * p_out_buffer,
+  SVec2i direction
+)
+{
+  // Each tile is left where the next one is entered, the last one where the
+  // traversal stopped
+  SImpactInformation impact;
+  while (raycast_traversal_step_toward(p_traversal, &impact, direction))
+  {
+    if (p_out_buffer->count > 0) p_out_buffer->p_impacts[p_out_buffer->count - 1].exit_time = impact.impact_time;
+    if (!record_impact(p_out_buffer, impact)) return RAYCAST_BUFFER_EXHAUSTED;
+  }
+
+  if (p_out_buffer->count > 0) p_out_buffer->p_impacts[p_out_buffer->count - 1].exit_time = raycast_traversal_exit_time(p_traversal);
+  return RAYCAST_SUCCESS;
+}
+
+static ERaycastResultType grid(SRaycastTraversal * p_traversal, SImpactBuffer * p_out_buffer)
+{
+  RAYCAST_TRAVERSAL_DISPATCH_DIRECTION(p_traversal, grid_toward, p_traversal, p_out_buffer);
+}
+
+ERaycastResultType raycast_grid
+(
+  const SGrid * p_grid,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactBuffer * p_out_buffer
+)
+{
+  PROFILE_ZONE("raycast_grid");
+  PROFILE_COUNT(PROFILE_COUNTER_RAYS_CAST, 1);
+  p_out_buffer->count = 0;
+
+  SRaycastTraversal traversal;
+  if (!raycast_traversal_begin(&traversal, p_grid, origin, vector)) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  const ERaycastResultType result = grid(&traversal, p_out_buffer);
+  PROFILE_COUNT(PROFILE_COUNTER_TILES_STEPPED, p_out_buffer->count);
+  return result;
+}
+
+// Tile storage queries of the first hit traversal. The traversal below is always
+// inlined with constant queries, so each storage gets its own specialized loop
+typedef bool (*FTileSolid)(const void * p_tiles, SVec2i tile);
+typedef int (*FEmptyBlockShift)(const void * p_tiles, SVec2i tile);
+
+static inline __attribute__((always_inline)) ERaycastResultType first_hit_toward
+(
+  SRaycastTraversal * p_traversal,
+  const void * p_tiles,
+  FTileSolid tile_solid,
+  FEmptyBlockShift empty_block_shift,
+  SImpactInformation * p_out_hit,
+  SVec2i direction
+)
+{
+  SImpactInformation impact;
+  for (;;)
+  {
+    // Leap to the far side of the largest empty block around the current tile
+    const int block_shift = empty_block_shift(p_tiles, p_traversal->current_tile);
+    if (block_shift > 0 && !raycast_traversal_skip_block_toward(p_traversal, block_shift, direction)) return RAYCAST_MISS;
+
+    if (!raycast_traversal_step_toward(p_traversal, &impact, direction)) return RAYCAST_MISS;
+
+    if (tile_solid(p_tiles, impact.impact_tile))
+    {
+      impact.exit_time = raycast_traversal_exit_time(p_traversal);
+      *p_out_hit = impact;
+      return RAYCAST_SUCCESS;
+    }
+  }
+}
+
+static inline __attribute__((always_inline)) ERaycastResultType first_hit
+(
+  const SGrid * p_grid,
+  const void * p_tiles,
+  FTileSolid tile_solid,
+  FEmptyBlockShift empty_block_shift,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+)
+{
+  PROFILE_COUNT(PROFILE_COUNTER_RAYS_CAST, 1);
+
+  SRaycastTraversal traversal;
+  if (!raycast_traversal_begin(&traversal, p_grid, origin, vector)) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  // A ray starting inside a solid tile is blocked right where it starts
+  if (tile_solid(p_tiles, traversal.current_tile))
+  {
+    *p_out_hit = raycast_traversal_origin_impact(&traversal);
+    return RAYCAST_SUCCESS;
+  }
+
+  RAYCAST_TRAVERSAL_DISPATCH_DIRECTION(&traversal, first_hit_toward, &traversal, p_tiles, tile_solid, empty_block_shift, p_out_hit);
+}
+
+static bool occupancy_tile_solid(const void * p_tiles, SVec2i tile)
+{
+  return tile_occupancy_solid(p_tiles, tile);
+}
+
+static int occupancy_empty_block_shift(const void * p_tiles, SVec2i tile)
+{
+  return tile_occupancy_empty_block_shift(p_tiles, tile);
+}
+
+static bool chunk_store_tile_solid(const void * p_tiles, SVec2i tile)
+{
+  return tile_chunk_store_solid(p_tiles, tile);
+}
+
+static int chunk_store_empty_block_shift(const void * p_tiles, SVec2i tile)
+{
+  return tile_chunk_store_empty_block_shift(p_tiles, tile);
+}
+
+ERaycastResultType raycast_first_hit
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+)
+{
+  if (!tile_occupancy_matches_grid(p_occupancy, p_grid)) return RAYCAST_OCCUPANCY_MISMATCH;
+
+  return first_hit(p_grid, p_occupancy, occupancy_tile_solid, occupancy_empty_block_shift, origin, vector, p_out_hit);
+}
+
+ERaycastResultType raycast_first_hit_chunked
+(
+  const SGrid * p_grid,
+  const STileChunkStore * p_store,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+)
+{
+  if (!tile_chunk_store_matches_grid(p_store, p_grid)) return RAYCAST_OCCUPANCY_MISMATCH;
+
+  return first_hit(p_grid, p_store, chunk_store_tile_solid, chunk_store_empty_block_shift, origin, vector, p_out_hit);
+}
@@ -0,0 +1,98 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "datatypes.h"
+#include "frame_arena.h"
+#include "tile_occupancy.h"
+#include "tile_chunk_store.h"
+
+typedef enum
+{
+  RAYCAST_SUCCESS,
+  RAYCAST_ORIGIN_OUT_OF_BOUNDS,
+  RAYCAST_BUFFER_EXHAUSTED,
+  RAYCAST_MISS,
+  // The tile storage passed along has a different number of tiles than the grid
+  RAYCAST_OCCUPANCY_MISMATCH
+} ERaycastResultType;
+
+// Caller owned storage the raycast writes its impacts into. Impacts beyond
+// the capacity are dropped and reported through RAYCAST_BUFFER_EXHAUSTED
+typedef struct
+{
+  SImpactInformation * p_impacts;
+  int capacity;
+  int count;
+} SImpactBuffer;
+
+// Grid size in pixels - Only representable for grids up to INT_MAX pixels per axis
+SVec2i raycast_grid_dimensions(const SGrid * p_grid);
+SAABB4f raycast_grid_bounding_box(const SGrid * p_grid);
+
+// Steps both axis in lockstep and records every tile entered, already ascending
+// in impact time, until the ray ends or leaves the grid
+ERaycastResultType raycast_grid(const SGrid * p_grid, SVec2f origin, SVec2f vector, SImpactBuffer * p_out_buffer);
+
+// Casts into the remaining memory of a per-thread frame arena and keeps only the
+// recorded impacts allocated. The resulting span stays valid until the arena is reset
+ERaycastResultType raycast_grid_arena(const SGrid * p_grid, SVec2f origin, SVec2f vector, SFrameArena * p_arena, SImpactBuffer * p_out_span);
+
+// Bytes of cursor state, enough for the traversal of the library
+#define RAYCAST_CURSOR_STATE_SIZE 96
+
+// Resumable traversal of a single ray, one tile crossing at a time. The state is
+// a fixed size and lives wherever the caller puts it, so stop conditions of any
+// kind need neither a buffer nor a limit on the ray length. Only the library
+// reads and writes the state, its layout may change between versions
+typedef struct
+{
+  union
+  {
+    uint64_t alignment;
+    unsigned char bytes[RAYCAST_CURSOR_STATE_SIZE];
+  } state;
+} SRaycastCursor;
+
+// Places the cursor on the tile containing the origin
+ERaycastResultType raycast_begin(SRaycastCursor * p_cursor, const SGrid * p_grid, SVec2f origin, SVec2f vector);
+
+// Crosses into the next tile and reports the same impact raycast_grid() records for
+// it. Returns false once the ray ends or leaves the grid, and keeps doing so, as a
+// stopped traversal stays on its last tile
+bool raycast_next(SRaycastCursor * p_cursor, SImpactInformation * p_out_impact);
+
+// Tile the cursor stands on, the origin tile until the first crossing
+SVec2i raycast_cursor_tile(const SRaycastCursor * p_cursor);
+
+// Stops at the first solid tile the ray enters and reports that impact, a ray that
+// starts inside a solid tile hits it at time zero. Returns RAYCAST_MISS when the
+// ray ends or leaves the grid without entering a solid tile. The occupancy has to
+// hold the tiles of the grid, with the same tiles on each axis, else nothing is
+// cast and RAYCAST_OCCUPANCY_MISMATCH is returned
+ERaycastResultType raycast_first_hit
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+);
+
+// First hit against sparse chunked tiles, for example a mapped map file. Empty
+// chunks and empty 8x8 blocks inside chunks are crossed in a single leap. Like
+// raycast_first_hit(), the store has to have the tiles on each axis the grid has,
+// else nothing is cast and RAYCAST_OCCUPANCY_MISMATCH is returned
+ERaycastResultType raycast_first_hit_chunked
+(
+  const SGrid * p_grid,
+  const STileChunkStore * p_store,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+);
+
+// Original traversal - Steps each axis on its own and sorts the merged impacts
+// afterwards. Kept as reference for the single pass traversal
+ERaycastResultType raycast_grid_per_axis(const SGrid * p_grid, SVec2f origin, SVec2f vector, SImpactBuffer * p_out_buffer);
+
+#endif
@@ -0,0 +1,559 @@
+#include "raycast_batch.h"
+#include "raycast_traversal.h"
+#include "profile.h"
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define RAYCAST_BATCH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#define MAX_LANES 8
+
+// The vector kernels stage the impacts of every lane and hand them to the rays at
+// least every STAGED_IMPACTS_PER_LANE steps. The spare slot behind the staged
+// impacts takes the records of lanes that do not record during a step
+#define STAGED_IMPACTS_PER_LANE 16
+
+// Traversal state of the rays currently assigned to the kernel lanes. A lane whose
+// ray is done is refilled with the next ray of the batch, so long rays do not keep
+// the other lanes idle. Idle lanes never cross an edge while they are stepped
+typedef struct
+{
+  int lanes;
+  int next_ray_index;
+  int active_lanes;
+  int ray_index[MAX_LANES];
+  float origin_x[MAX_LANES];
+  float origin_y[MAX_LANES];
+  float vector_x[MAX_LANES];
+  float vector_y[MAX_LANES];
+  float intersect_times_initial_x[MAX_LANES];
+  float intersect_times_initial_y[MAX_LANES];
+  float intersect_time_per_tile_x[MAX_LANES];
+  float intersect_time_per_tile_y[MAX_LANES];
+  float edge_position_initial_x[MAX_LANES];
+  float edge_position_initial_y[MAX_LANES];
+  float edge_position_per_tile_x[MAX_LANES];
+  float edge_position_per_tile_y[MAX_LANES];
+  int direction_x[MAX_LANES];
+  int direction_y[MAX_LANES];
+  int current_tile_x[MAX_LANES];
+  int current_tile_y[MAX_LANES];
+  int edges_crossed_x[MAX_LANES];
+  int edges_crossed_y[MAX_LANES];
+  int staged_count[MAX_LANES];
+  SImpactInformation staged_impacts[MAX_LANES][STAGED_IMPACTS_PER_LANE + 1];
+} SRayLanes;
+
+static void assign_lane(SRayLanes * p_lanes, int lane, int ray_index, const SRaycastTraversal * p_traversal)
+{
+  p_lanes->ray_index[lane] = ray_index;
+  p_lanes->origin_x[lane] = p_traversal->origin.x;
+  p_lanes->origin_y[lane] = p_traversal->origin.y;
+  p_lanes->vector_x[lane] = p_traversal->vector.x;
+  p_lanes->vector_y[lane] = p_traversal->vector.y;
+  p_lanes->intersect_times_initial_x[lane] = p_traversal->intersect_times_initial.x;
+  p_lanes->intersect_times_initial_y[lane] = p_traversal->intersect_times_initial.y;
+  p_lanes->intersect_time_per_tile_x[lane] = p_traversal->intersect_time_per_tile.x;
+  p_lanes->intersect_time_per_tile_y[lane] = p_traversal->intersect_time_per_tile.y;
+  p_lanes->edge_position_initial_x[lane] = p_traversal->edge_position_initial.x;
+  p_lanes->edge_position_initial_y[lane] = p_traversal->edge_position_initial.y;
+  p_lanes->edge_position_per_tile_x[lane] = p_traversal->edge_position_per_tile.x;
+  p_lanes->edge_position_per_tile_y[lane] = p_traversal->edge_position_per_tile.y;
+  p_lanes->direction_x[lane] = p_traversal->direction.x;
+  p_lanes->direction_y[lane] = p_traversal->direction.y;
+  p_lanes->current_tile_x[lane] = p_traversal->current_tile.x;
+  p_lanes->current_tile_y[lane] = p_traversal->current_tile.y;
+  p_lanes->edges_crossed_x[lane] = p_traversal->edges_crossed.x;
+  p_lanes->edges_crossed_y[lane] = p_traversal->edges_crossed.y;
+  p_lanes->staged_count[lane] = 0;
+}
+
+// Assigns the next traversable rays of the batch to all idle lanes. Rays with an
+// origin outside of the grid are resolved right away and never take a lane
+static void refill_idle_lanes
+(
+  SRayLanes * p_lanes,
+  const SGrid * p_grid,
+  const SRayBatch * p_batch,
+  SRayBatchResults * p_results
+)
+{
+  for (int lane = 0; lane < p_lanes->lanes; lane++)
+  {
+    if ((p_lanes->active_lanes >> lane) & 1) continue;
+
+    SRaycastTraversal traversal;
+    bool traversable = false;
+
+    while (!traversable && p_lanes->next_ray_index < p_batch->count)
+    {
+      const int ray_index = p_lanes->next_ray_index++;
+      const SVec2f origin = { p_batch->p_origin_x[ray_index], p_batch->p_origin_y[ray_index] };
+      const SVec2f vector = { p_batch->p_vector_x[ray_index], p_batch->p_vector_y[ray_index] };
+
+      traversable = raycast_traversal_begin(&traversal, p_grid, origin, vector);
+      p_results->p_impact_counts[ray_index] = 0;
+      p_results->p_results[ray_index] = traversable ? RAYCAST_SUCCESS : RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+      if (traversable)
+      {
+        assign_lane(p_lanes, lane, ray_index, &traversal);
+        p_lanes->active_lanes |= 1 << lane;
+      }
+    }
+
+    if (!traversable)
+    {
+      traversal = (SRaycastTraversal) { 0 };
+      traversal.intersect_times_initial = (SVec2f) { INFINITY, INFINITY };
+      assign_lane(p_lanes, lane, -1, &traversal);
+    }
+  }
+}
+
+// Appends the staged impacts of every lane to its ray. Rays that ran out of hit
+// list space are done and drop out of the active lanes
+static void flush_staged_impacts(SRayLanes * p_lanes, SRayBatchResults * p_results)
+{
+  for (int lane = 0; lane < p_lanes->lanes; lane++)
+  {
+    const int staged_count = p_lanes->staged_count[lane];
+    if (staged_count == 0) continue;
+
+    const int ray_index = p_lanes->ray_index[lane];
+    const int impact_count = p_results->p_impact_counts[ray_index];
+    const int remaining_room = p_results->impacts_per_ray - impact_count;
+    const int copied_count = staged_count < remaining_room ? staged_count : remaining_room;
+
+    memcpy(
+      p_results->p_impacts + (size_t)ray_index * p_results->impacts_per_ray + impact_count,
+      p_lanes->staged_impacts[lane],
+      sizeof(SImpactInformation) * copied_count
+    );
+    p_results->p_impact_counts[ray_index] = impact_count + copied_count;
+    p_lanes->staged_count[lane] = 0;
+
+    if (staged_count > remaining_room)
+    {
+      p_results->p_results[ray_index] = RAYCAST_BUFFER_EXHAUSTED;
+      p_lanes->active_lanes &= ~(1 << lane);
+    }
+  }
+}
+
+static void raycast_batch_scalar(const SGrid * p_grid, const SRayBatch * p_batch, SRayBatchResults * p_results)
+{
+  for (int ray_index = 0; ray_index < p_batch->count; ray_index++)
+  {
+    SImpactBuffer ray_buffer = {
+      p_results->p_impacts + (size_t)ray_index * p_results->impacts_per_ray,
+      p_results->impacts_per_ray,
+      0
+    };
+    const SVec2f origin = { p_batch->p_origin_x[ray_index], p_batch->p_origin_y[ray_index] };
+    const SVec2f vector = { p_batch->p_vector_x[ray_index], p_batch->p_vector_y[ray_index] };
+
+    p_results->p_results[ray_index] = raycast_grid(p_grid, origin, vector, &ray_buffer);
+    p_results->p_impact_counts[ray_index] = ray_buffer.count;
+  }
+}
+
+#ifdef RAYCAST_BATCH_X86_KERNELS
+
+// Writes the step impact of a lane behind its staged impacts. The eight 32 bit
+// fields of a record are written as two halves, the time, point and tile x, then
+// the tile y, normal and exit time.
+// Always inlined, so the vector kernels never call into legacy SSE encoded code
+// with dirty upper AVX registers, which stalls on every single step
+static inline __attribute__((always_inline)) void stage_lane_impact
+(
+  SRayLanes * p_lanes,
+  int lane,
+  __m128 leading_fields,
+  __m128 trailing_fields
+)
+{
+  float * const p_staged_impact = (float *)&p_lanes->staged_impacts[lane][p_lanes->staged_count[lane]];
+
+  _mm_storeu_ps(p_staged_impact, leading_fields);
+  _mm_storeu_ps(p_staged_impact + 4, trailing_fields);
+}
+
+// Expands a lane bit mask into all bits set for every lane in the mask
+__attribute__((target("sse2")))
+static inline __m128 lanes_from_bits_sse2(int lane_bits)
+{
+  const __m128i lane_bit_values = _mm_setr_epi32(1, 2, 4, 8);
+  const __m128i lanes = _mm_and_si128(_mm_set1_epi32(lane_bits), lane_bit_values);
+
+  return _mm_castsi128_ps(_mm_cmpeq_epi32(lanes, lane_bit_values));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 lanes_from_bits_avx2(int lane_bits)
+{
+  const __m256i lane_bit_values = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  const __m256i lanes = _mm256_and_si256(_mm256_set1_epi32(lane_bits), lane_bit_values);
+
+  return _mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, lane_bit_values));
+}
+
+// The vector kernels evaluate the same expressions as raycast_traversal_step() in the
+// same order, so every lane produces bit identical impacts to the scalar traversal.
+//
+// Lanes are stepped until the staging is full, or half of the lanes went idle while
+// there are rays left to refill them with. Then the lane state is stored, the staged
+// impacts are flushed, idle lanes are refilled and the lane state is loaded again
+
+__attribute__((target("sse2")))
+static void raycast_batch_sse2(const SGrid * p_grid, const SRayBatch * p_batch, SRayBatchResults * p_results)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i last_tile_x = _mm_set1_epi32(p_grid->tiles_on_axis.x - 1);
+  const __m128i last_tile_y = _mm_set1_epi32(p_grid->tiles_on_axis.y - 1);
+
+  SRayLanes lanes = { .lanes = 4 };
+  refill_idle_lanes(&lanes, p_grid, p_batch, p_results);
+
+  while (lanes.active_lanes != 0)
+  {
+    const __m128 origin_x = _mm_loadu_ps(lanes.origin_x);
+    const __m128 origin_y = _mm_loadu_ps(lanes.origin_y);
+    const __m128 vector_x = _mm_loadu_ps(lanes.vector_x);
+    const __m128 vector_y = _mm_loadu_ps(lanes.vector_y);
+    const __m128 intersect_times_initial_x = _mm_loadu_ps(lanes.intersect_times_initial_x);
+    const __m128 intersect_times_initial_y = _mm_loadu_ps(lanes.intersect_times_initial_y);
+    const __m128 intersect_time_per_tile_x = _mm_loadu_ps(lanes.intersect_time_per_tile_x);
+    const __m128 intersect_time_per_tile_y = _mm_loadu_ps(lanes.intersect_time_per_tile_y);
+    const __m128 edge_position_initial_x = _mm_loadu_ps(lanes.edge_position_initial_x);
+    const __m128 edge_position_initial_y = _mm_loadu_ps(lanes.edge_position_initial_y);
+    const __m128 edge_position_per_tile_x = _mm_loadu_ps(lanes.edge_position_per_tile_x);
+    const __m128 edge_position_per_tile_y = _mm_loadu_ps(lanes.edge_position_per_tile_y);
+    const __m128i direction_x = _mm_loadu_si128((const __m128i *)lanes.direction_x);
+    const __m128i direction_y = _mm_loadu_si128((const __m128i *)lanes.direction_y);
+
+    __m128i current_tile_x = _mm_loadu_si128((const __m128i *)lanes.current_tile_x);
+    __m128i current_tile_y = _mm_loadu_si128((const __m128i *)lanes.current_tile_y);
+    __m128i edges_crossed_x = _mm_loadu_si128((const __m128i *)lanes.edges_crossed_x);
+    __m128i edges_crossed_y = _mm_loadu_si128((const __m128i *)lanes.edges_crossed_y);
+    __m128i staged_counts = zero;
+    __m128 active = lanes_from_bits_sse2(lanes.active_lanes);
+
+    const bool rays_left = lanes.next_ray_index < p_batch->count;
+    int active_lanes = lanes.active_lanes;
+
+    for (int staged_steps = 0; staged_steps < STAGED_IMPACTS_PER_LANE; staged_steps++)
+    {
+      const __m128 edges_crossed_x_float = _mm_cvtepi32_ps(edges_crossed_x);
+      const __m128 edges_crossed_y_float = _mm_cvtepi32_ps(edges_crossed_y);
+      const __m128 next_impact_time_x = _mm_add_ps(intersect_times_initial_x, _mm_mul_ps(intersect_time_per_tile_x, edges_crossed_x_float));
+      const __m128 next_impact_time_y = _mm_add_ps(intersect_times_initial_y, _mm_mul_ps(intersect_time_per_tile_y, edges_crossed_y_float));
+
+      const __m128 crosses_vertical_edge = _mm_cmple_ps(next_impact_time_x, next_impact_time_y);
+      const __m128 impact_time = _mm_or_ps(
+        _mm_and_ps(crosses_vertical_edge, next_impact_time_x),
+        _mm_andnot_ps(crosses_vertical_edge, next_impact_time_y)
+      );
+
+      // Lanes whose next impact is further than their ray reaches are done
+      const __m128 stepping = _mm_and_ps(active, _mm_cmple_ps(impact_time, one));
+      const __m128i step_x = _mm_castps_si128(_mm_and_ps(stepping, crosses_vertical_edge));
+      const __m128i step_y = _mm_castps_si128(_mm_andnot_ps(crosses_vertical_edge, stepping));
+
+      const __m128 impact_point_x = _mm_or_ps(
+        _mm_and_ps(crosses_vertical_edge, _mm_add_ps(edge_position_initial_x, _mm_mul_ps(edge_position_per_tile_x, edges_crossed_x_float))),
+        _mm_andnot_ps(crosses_vertical_edge, _mm_add_ps(origin_x, _mm_mul_ps(vector_x, impact_time)))
+      );
+      const __m128 impact_point_y = _mm_or_ps(
+        _mm_and_ps(crosses_vertical_edge, _mm_add_ps(origin_y, _mm_mul_ps(vector_y, impact_time))),
+        _mm_andnot_ps(crosses_vertical_edge, _mm_add_ps(edge_position_initial_y, _mm_mul_ps(edge_position_per_tile_y, edges_crossed_y_float)))
+      );
+
+      // Step masks are all bits set, so subtracting them counts the crossed edges up
+      current_tile_x = _mm_add_epi32(current_tile_x, _mm_and_si128(step_x, direction_x));
+      current_tile_y = _mm_add_epi32(current_tile_y, _mm_and_si128(step_y, direction_y));
+      edges_crossed_x = _mm_sub_epi32(edges_crossed_x, step_x);
+      edges_crossed_y = _mm_sub_epi32(edges_crossed_y, step_y);
+
+      // Lanes whose ray left the grid are done
+      const __m128i out_of_bounds = _mm_or_si128(
+        _mm_or_si128(_mm_cmplt_epi32(current_tile_x, zero), _mm_cmpgt_epi32(current_tile_x, last_tile_x)),
+        _mm_or_si128(_mm_cmplt_epi32(current_tile_y, zero), _mm_cmpgt_epi32(current_tile_y, last_tile_y))
+      );
+      active = _mm_andnot_ps(_mm_castsi128_ps(out_of_bounds), stepping);
+      active_lanes = _mm_movemask_ps(active);
+
+      // The entered tile is left at the next impact time of either axis
+      const __m128 exit_time_x = _mm_add_ps(intersect_times_initial_x, _mm_mul_ps(intersect_time_per_tile_x, _mm_cvtepi32_ps(edges_crossed_x)));
+      const __m128 exit_time_y = _mm_add_ps(intersect_times_initial_y, _mm_mul_ps(intersect_time_per_tile_y, _mm_cvtepi32_ps(edges_crossed_y)));
+      const __m128 exit_time = _mm_min_ps(_mm_min_ps(exit_time_x, exit_time_y), one);
+      const __m128i impact_normal_x = _mm_and_si128(_mm_castps_si128(crosses_vertical_edge), _mm_sub_epi32(zero, direction_x));
+      const __m128i impact_normal_y = _mm_andnot_si128(_mm_castps_si128(crosses_vertical_edge), _mm_sub_epi32(zero, direction_y));
+
+      // Transpose the lanes into records, the integer bits pass the float shuffles unchanged
+      __m128 record_0 = impact_time;
+      __m128 record_1 = impact_point_x;
+      __m128 record_2 = impact_point_y;
+      __m128 record_3 = _mm_castsi128_ps(current_tile_x);
+      _MM_TRANSPOSE4_PS(record_0, record_1, record_2, record_3);
+
+      __m128 record_tail_0 = _mm_castsi128_ps(current_tile_y);
+      __m128 record_tail_1 = _mm_castsi128_ps(impact_normal_x);
+      __m128 record_tail_2 = _mm_castsi128_ps(impact_normal_y);
+      __m128 record_tail_3 = exit_time;
+      _MM_TRANSPOSE4_PS(record_tail_0, record_tail_1, record_tail_2, record_tail_3);
+
+      // Every lane stages its record, only recording lanes keep it by counting it
+      _mm_storeu_si128((__m128i *)lanes.staged_count, staged_counts);
+      stage_lane_impact(&lanes, 0, record_0, record_tail_0);
+      stage_lane_impact(&lanes, 1, record_1, record_tail_1);
+      stage_lane_impact(&lanes, 2, record_2, record_tail_2);
+      stage_lane_impact(&lanes, 3, record_3, record_tail_3);
+      staged_counts = _mm_sub_epi32(staged_counts, _mm_castps_si128(active));
+
+      if (active_lanes == 0 || (rays_left && __builtin_popcount(active_lanes) * 2 <= lanes.lanes)) break;
+    }
+
+    _mm_storeu_si128((__m128i *)lanes.current_tile_x, current_tile_x);
+    _mm_storeu_si128((__m128i *)lanes.current_tile_y, current_tile_y);
+    _mm_storeu_si128((__m128i *)lanes.edges_crossed_x, edges_crossed_x);
+    _mm_storeu_si128((__m128i *)lanes.edges_crossed_y, edges_crossed_y);
+    _mm_storeu_si128((__m128i *)lanes.staged_count, staged_counts);
+    lanes.active_lanes = active_lanes;
+
+    flush_staged_impacts(&lanes, p_results);
+    refill_idle_lanes(&lanes, p_grid, p_batch, p_results);
+  }
+}
+
+__attribute__((target("avx2")))
+static void raycast_batch_avx2(const SGrid * p_grid, const SRayBatch * p_batch, SRayBatchResults * p_results)
+{
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i last_tile_x = _mm256_set1_epi32(p_grid->tiles_on_axis.x - 1);
+  const __m256i last_tile_y = _mm256_set1_epi32(p_grid->tiles_on_axis.y - 1);
+
+  SRayLanes lanes = { .lanes = 8 };
+  refill_idle_lanes(&lanes, p_grid, p_batch, p_results);
+
+  while (lanes.active_lanes != 0)
+  {
+    const __m256 origin_x = _mm256_loadu_ps(lanes.origin_x);
+    const __m256 origin_y = _mm256_loadu_ps(lanes.origin_y);
+    const __m256 vector_x = _mm256_loadu_ps(lanes.vector_x);
+    const __m256 vector_y = _mm256_loadu_ps(lanes.vector_y);
+    const __m256 intersect_times_initial_x = _mm256_loadu_ps(lanes.intersect_times_initial_x);
+    const __m256 intersect_times_initial_y = _mm256_loadu_ps(lanes.intersect_times_initial_y);
+    const __m256 intersect_time_per_tile_x = _mm256_loadu_ps(lanes.intersect_time_per_tile_x);
+    const __m256 intersect_time_per_tile_y = _mm256_loadu_ps(lanes.intersect_time_per_tile_y);
+    const __m256 edge_position_initial_x = _mm256_loadu_ps(lanes.edge_position_initial_x);
+    const __m256 edge_position_initial_y = _mm256_loadu_ps(lanes.edge_position_initial_y);
+    const __m256 edge_position_per_tile_x = _mm256_loadu_ps(lanes.edge_position_per_tile_x);
+    const __m256 edge_position_per_tile_y = _mm256_loadu_ps(lanes.edge_position_per_tile_y);
+    const __m256i direction_x = _mm256_loadu_si256((const __m256i *)lanes.direction_x);
+    const __m256i direction_y = _mm256_loadu_si256((const __m256i *)lanes.direction_y);
+
+    __m256i current_tile_x = _mm256_loadu_si256((const __m256i *)lanes.current_tile_x);
+    __m256i current_tile_y = _mm256_loadu_si256((const __m256i *)lanes.current_tile_y);
+    __m256i edges_crossed_x = _mm256_loadu_si256((const __m256i *)lanes.edges_crossed_x);
+    __m256i edges_crossed_y = _mm256_loadu_si256((const __m256i *)lanes.edges_crossed_y);
+    __m256i staged_counts = zero;
+    __m256 active = lanes_from_bits_avx2(lanes.active_lanes);
+
+    const bool rays_left = lanes.next_ray_index < p_batch->count;
+    int active_lanes = lanes.active_lanes;
+
+    for (int staged_steps = 0; staged_steps < STAGED_IMPACTS_PER_LANE; staged_steps++)
+    {
+      const __m256 edges_crossed_x_float = _mm256_cvtepi32_ps(edges_crossed_x);
+      const __m256 edges_crossed_y_float = _mm256_cvtepi32_ps(edges_crossed_y);
+      const __m256 next_impact_time_x = _mm256_add_ps(intersect_times_initial_x, _mm256_mul_ps(intersect_time_per_tile_x, edges_crossed_x_float));
+      const __m256 next_impact_time_y = _mm256_add_ps(intersect_times_initial_y, _mm256_mul_ps(intersect_time_per_tile_y, edges_crossed_y_float));
+
+      const __m256 crosses_vertical_edge = _mm256_cmp_ps(next_impact_time_x, next_impact_time_y, _CMP_LE_OQ);
+      const __m256 impact_time = _mm256_blendv_ps(next_impact_time_y, next_impact_time_x, crosses_vertical_edge);
+
+      // Lanes whose next impact is further than their ray reaches are done
+      const __m256 stepping = _mm256_and_ps(active, _mm256_cmp_ps(impact_time, one, _CMP_LE_OQ));
+      const __m256i step_x = _mm256_castps_si256(_mm256_and_ps(stepping, crosses_vertical_edge));
+      const __m256i step_y = _mm256_castps_si256(_mm256_andnot_ps(crosses_vertical_edge, stepping));
+
+      const __m256 impact_point_x = _mm256_blendv_ps(
+        _mm256_add_ps(origin_x, _mm256_mul_ps(vector_x, impact_time)),
+        _mm256_add_ps(edge_position_initial_x, _mm256_mul_ps(edge_position_per_tile_x, edges_crossed_x_float)),
+        crosses_vertical_edge
+      );
+      const __m256 impact_point_y = _mm256_blendv_ps(
+        _mm256_add_ps(edge_position_initial_y, _mm256_mul_ps(edge_position_per_tile_y, edges_crossed_y_float)),
+        _mm256_add_ps(origin_y, _mm256_mul_ps(vector_y, impact_time)),
+        crosses_vertical_edge
+      );
+
+      // Step masks are all bits set, so subtracting them counts the crossed edges up
+      current_tile_x = _mm256_add_epi32(current_tile_x, _mm256_and_si256(step_x, direction_x));
+      current_tile_y = _mm256_add_epi32(current_tile_y, _mm256_and_si256(step_y, direction_y));
+      edges_crossed_x = _mm256_sub_epi32(edges_crossed_x, step_x);
+      edges_crossed_y = _mm256_sub_epi32(edges_crossed_y, step_y);
+
+      // Lanes whose ray left the grid are done
+      const __m256i out_of_bounds = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, current_tile_x), _mm256_cmpgt_epi32(current_tile_x, last_tile_x)),
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, current_tile_y), _mm256_cmpgt_epi32(current_tile_y, last_tile_y))
+      );
+      active = _mm256_andnot_ps(_mm256_castsi256_ps(out_of_bounds), stepping);
+      active_lanes = _mm256_movemask_ps(active);
+
+      // The entered tile is left at the next impact time of either axis
+      const __m256 exit_time_x = _mm256_add_ps(intersect_times_initial_x, _mm256_mul_ps(intersect_time_per_tile_x, _mm256_cvtepi32_ps(edges_crossed_x)));
+      const __m256 exit_time_y = _mm256_add_ps(intersect_times_initial_y, _mm256_mul_ps(intersect_time_per_tile_y, _mm256_cvtepi32_ps(edges_crossed_y)));
+      const __m256 exit_time = _mm256_min_ps(_mm256_min_ps(exit_time_x, exit_time_y), one);
+      const __m256i impact_normal_x = _mm256_and_si256(_mm256_castps_si256(crosses_vertical_edge), _mm256_sub_epi32(zero, direction_x));
+      const __m256i impact_normal_y = _mm256_andnot_si256(_mm256_castps_si256(crosses_vertical_edge), _mm256_sub_epi32(zero, direction_y));
+
+      // Transpose the lanes into records within both 128 bit halves, the integer bits
+      // pass the float shuffles unchanged
+      const __m256 time_point_x_low = _mm256_unpacklo_ps(impact_time, impact_point_x);
+      const __m256 time_point_x_high = _mm256_unpackhi_ps(impact_time, impact_point_x);
+      const __m256 point_y_tile_x_low = _mm256_unpacklo_ps(impact_point_y, _mm256_castsi256_ps(current_tile_x));
+      const __m256 point_y_tile_x_high = _mm256_unpackhi_ps(impact_point_y, _mm256_castsi256_ps(current_tile_x));
+      const __m256 records_0_4 = _mm256_shuffle_ps(time_point_x_low, point_y_tile_x_low, 0x44);
+      const __m256 records_1_5 = _mm256_shuffle_ps(time_point_x_low, point_y_tile_x_low, 0xEE);
+      const __m256 records_2_6 = _mm256_shuffle_ps(time_point_x_high, point_y_tile_x_high, 0x44);
+      const __m256 records_3_7 = _mm256_shuffle_ps(time_point_x_high, point_y_tile_x_high, 0xEE);
+
+      const __m256 tile_y_normal_x_low = _mm256_unpacklo_ps(_mm256_castsi256_ps(current_tile_y), _mm256_castsi256_ps(impact_normal_x));
+      const __m256 tile_y_normal_x_high = _mm256_unpackhi_ps(_mm256_castsi256_ps(current_tile_y), _mm256_castsi256_ps(impact_normal_x));
+      const __m256 normal_y_exit_time_low = _mm256_unpacklo_ps(_mm256_castsi256_ps(impact_normal_y), exit_time);
+      const __m256 normal_y_exit_time_high = _mm256_unpackhi_ps(_mm256_castsi256_ps(impact_normal_y), exit_time);
+      const __m256 record_tails_0_4 = _mm256_shuffle_ps(tile_y_normal_x_low, normal_y_exit_time_low, 0x44);
+      const __m256 record_tails_1_5 = _mm256_shuffle_ps(tile_y_normal_x_low, normal_y_exit_time_low, 0xEE);
+      const __m256 record_tails_2_6 = _mm256_shuffle_ps(tile_y_normal_x_high, normal_y_exit_time_high, 0x44);
+      const __m256 record_tails_3_7 = _mm256_shuffle_ps(tile_y_normal_x_high, normal_y_exit_time_high, 0xEE);
+
+      // Every lane stages its record, only recording lanes keep it by counting it
+      _mm256_storeu_si256((__m256i *)lanes.staged_count, staged_counts);
+      stage_lane_impact(&lanes, 0, _mm256_castps256_ps128(records_0_4), _mm256_castps256_ps128(record_tails_0_4));
+      stage_lane_impact(&lanes, 1, _mm256_castps256_ps128(records_1_5), _mm256_castps256_ps128(record_tails_1_5));
+      stage_lane_impact(&lanes, 2, _mm256_castps256_ps128(records_2_6), _mm256_castps256_ps128(record_tails_2_6));
+      stage_lane_impact(&lanes, 3, _mm256_castps256_ps128(records_3_7), _mm256_castps256_ps128(record_tails_3_7));
+      stage_lane_impact(&lanes, 4, _mm256_extractf128_ps(records_0_4, 1), _mm256_extractf128_ps(record_tails_0_4, 1));
+      stage_lane_impact(&lanes, 5, _mm256_extractf128_ps(records_1_5, 1), _mm256_extractf128_ps(record_tails_1_5, 1));
+      stage_lane_impact(&lanes, 6, _mm256_extractf128_ps(records_2_6, 1), _mm256_extractf128_ps(record_tails_2_6, 1));
+      stage_lane_impact(&lanes, 7, _mm256_extractf128_ps(records_3_7, 1), _mm256_extractf128_ps(record_tails_3_7, 1));
+      staged_counts = _mm256_sub_epi32(staged_counts, _mm256_castps_si256(active));
+
+      if (active_lanes == 0 || (rays_left && __builtin_popcount(active_lanes) * 2 <= lanes.lanes)) break;
+    }
+
+    _mm256_storeu_si256((__m256i *)lanes.current_tile_x, current_tile_x);
+    _mm256_storeu_si256((__m256i *)lanes.current_tile_y, current_tile_y);
+    _mm256_storeu_si256((__m256i *)lanes.edges_crossed_x, edges_crossed_x);
+    _mm256_storeu_si256((__m256i *)lanes.edges_crossed_y, edges_crossed_y);
+    _mm256_storeu_si256((__m256i *)lanes.staged_count, staged_counts);
+    lanes.active_lanes = active_lanes;
+
+    flush_staged_impacts(&lanes, p_results);
+    refill_idle_lanes(&lanes, p_grid, p_batch, p_results);
+  }
+}
+
+#endif
+
+static bool kernel_supported(ERaycastBatchKernelType kernel)
+{
+  switch (kernel)
+  {
+#ifdef RAYCAST_BATCH_X86_KERNELS
+    case RAYCAST_BATCH_KERNEL_AVX2:
+      return __builtin_cpu_supports("avx2");
+    case RAYCAST_BATCH_KERNEL_SSE2:
+      return __builtin_cpu_supports("sse2");
+#endif
+    case RAYCAST_BATCH_KERNEL_SCALAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+ERaycastBatchKernelType raycast_batch_best_kernel(void)
+{
+  // Four lanes do not outweigh the lane bookkeeping, so the SSE2 kernel trails the
+  // scalar traversal and is only picked when asked for explicitly
+#ifdef RAYCAST_BATCH_X86_KERNELS
+  if (__builtin_cpu_supports("avx2")) return RAYCAST_BATCH_KERNEL_AVX2;
+#endif
+
+  return RAYCAST_BATCH_KERNEL_SCALAR;
+}
+
+const char * raycast_batch_kernel_name(ERaycastBatchKernelType kernel)
+{
+  switch (kernel)
+  {
+    case RAYCAST_BATCH_KERNEL_AVX2:
+      return "avx2";
+    case RAYCAST_BATCH_KERNEL_SSE2:
+      return "sse2";
+    default:
+      return "scalar";
+  }
+}
+
+void raycast_grid_batch(const SGrid * p_grid, const SRayBatch * p_batch, SRayBatchResults * p_results)
+{
+  raycast_grid_batch_with_kernel(p_grid, p_batch, p_results, raycast_batch_best_kernel());
+}
+
+#ifdef RAYCAST_BATCH_X86_KERNELS
+
+// Counts the rays and tiles of a batch cast by a vector kernel. The scalar kernel
+// casts through raycast_grid(), which already counts every ray it casts
+static void count_vector_batch(const SRayBatch * p_batch, const SRayBatchResults * p_results)
+{
+#ifdef RAYCAST_PROFILE
+  uint64_t tiles_stepped = 0;
+  for (int ray_index = 0; ray_index < p_batch->count; ray_index++) tiles_stepped += p_results->p_impact_counts[ray_index];
+
+  PROFILE_COUNT(PROFILE_COUNTER_RAYS_CAST, p_batch->count);
+  PROFILE_COUNT(PROFILE_COUNTER_TILES_STEPPED, tiles_stepped);
+#else
+  (void)p_batch;
+  (void)p_results;
+#endif
+}
+
+#endif
+
+void raycast_grid_batch_with_kernel
+(
+  const SGrid * p_grid,
+  const SRayBatch * p_batch,
+  SRayBatchResults * p_results,
+  ERaycastBatchKernelType kernel
+)
+{
+  PROFILE_ZONE("raycast_grid_batch");
+  if (!kernel_supported(kernel)) kernel = raycast_batch_best_kernel();
+
+  switch (kernel)
+  {
+#ifdef RAYCAST_BATCH_X86_KERNELS
+    case RAYCAST_BATCH_KERNEL_AVX2:
+      raycast_batch_avx2(p_grid, p_batch, p_results);
+      count_vector_batch(p_batch, p_results);
+      break;
+    case RAYCAST_BATCH_KERNEL_SSE2:
+      raycast_batch_sse2(p_grid, p_batch, p_results);
+      count_vector_batch(p_batch, p_results);
+      break;
+#endif
+    default:
+      raycast_batch_scalar(p_grid, p_batch, p_results);
+      break;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef RAYCAST_BATCH_H
+#define RAYCAST_BATCH_H
+
+#include "raycast.h"
+
+// Rays in structure of arrays layout, so consecutive rays load into consecutive lanes
+typedef struct
+{
+  const float * p_origin_x;
+  const float * p_origin_y;
+  const float * p_vector_x;
+  const float * p_vector_y;
+  int count;
+} SRayBatch;
+
+// Per ray hit lists - Ray i owns the impacts_per_ray impacts starting at
+// p_impacts + i * impacts_per_ray and reports its count and result at index i
+typedef struct
+{
+  SImpactInformation * p_impacts;
+  int impacts_per_ray;
+  int * p_impact_counts;
+  ERaycastResultType * p_results;
+} SRayBatchResults;
+
+typedef enum
+{
+  RAYCAST_BATCH_KERNEL_SCALAR,
+  RAYCAST_BATCH_KERNEL_SSE2,
+  RAYCAST_BATCH_KERNEL_AVX2
+} ERaycastBatchKernelType;
+
+// Fastest kernel the running CPU supports
+ERaycastBatchKernelType raycast_batch_best_kernel(void);
+const char * raycast_batch_kernel_name(ERaycastBatchKernelType kernel);
+
+// Every kernel produces exactly the impacts raycast_grid() does for each ray
+void raycast_grid_batch(const SGrid * p_grid, const SRayBatch * p_batch, SRayBatchResults * p_results);
+
+// Kernels the running CPU does not support fall back to the best supported one
+void raycast_grid_batch_with_kernel
+(
+  const SGrid * p_grid,
+  const SRayBatch * p_batch,
+  SRayBatchResults * p_results,
+  ERaycastBatchKernelType kernel
+);
+
+#endif
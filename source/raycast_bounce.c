@@ -0,0 +1,137 @@
+#include "raycast_bounce.h"
+#include "raycast_traversal.h"
+#include <math.h>
+
+// Same loop as the plain first hit, continuing the given traversal
+static inline __attribute__((always_inline)) bool segment_hit_toward
+(
+  SRaycastTraversal * p_traversal,
+  const STileOccupancy * p_occupancy,
+  SImpactInformation * p_out_hit,
+  SVec2i direction
+)
+{
+  for (;;)
+  {
+    const int block_shift = tile_occupancy_empty_block_shift(p_occupancy, p_traversal->current_tile);
+    if (block_shift > 0 && !raycast_traversal_skip_block_toward(p_traversal, block_shift, direction)) return false;
+
+    if (!raycast_traversal_step_toward(p_traversal, p_out_hit, direction)) return false;
+
+    if (tile_occupancy_solid(p_occupancy, p_out_hit->impact_tile))
+    {
+      p_out_hit->exit_time = raycast_traversal_exit_time(p_traversal);
+      return true;
+    }
+  }
+}
+
+static bool segment_hit(SRaycastTraversal * p_traversal, const STileOccupancy * p_occupancy, SImpactInformation * p_out_hit)
+{
+  RAYCAST_TRAVERSAL_DISPATCH_DIRECTION(p_traversal, segment_hit_toward, p_traversal, p_occupancy, p_out_hit);
+}
+
+// Direction scaled to the given length, zero for a zero direction
+static SVec2f scaled_direction(SVec2f direction, float length)
+{
+  const float direction_length = sqrtf(direction.x * direction.x + direction.y * direction.y);
+  if (!(direction_length > 0.0f)) return (SVec2f) { 0.0f, 0.0f };
+
+  const float scale = length / direction_length;
+  return (SVec2f) { direction.x * scale, direction.y * scale };
+}
+
+static SRaycastBounce reflect_always(void * p_context, const SRaycastSegment * p_segment)
+{
+  (void)p_context;
+  (void)p_segment;
+  return (SRaycastBounce) { RAYCAST_BOUNCE_REFLECT, { 0.0f, 0.0f }, { 0.0f, 0.0f } };
+}
+
+ERaycastResultType raycast_first_hit_segments
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  FRaycastBounce bounce,
+  void * p_context,
+  SRaycastSegmentBuffer * p_out_segments
+)
+{
+  if (bounce == NULL) bounce = reflect_always;
+  p_out_segments->count = 0;
+  if (!tile_occupancy_matches_grid(p_occupancy, p_grid)) return RAYCAST_OCCUPANCY_MISMATCH;
+
+  SRaycastTraversal traversal;
+  if (!raycast_traversal_begin(&traversal, p_grid, origin, vector)) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  // Only fresh traversals check their start tile, continuations from an impact
+  // point start next to or inside the tile they hit on purpose
+  bool check_start_tile = true;
+  for (;;)
+  {
+    if (p_out_segments->count == p_out_segments->capacity) return RAYCAST_BUFFER_EXHAUSTED;
+
+    SRaycastSegment * const p_segment = &p_out_segments->p_segments[p_out_segments->count++];
+    p_segment->origin = traversal.origin;
+    p_segment->vector = traversal.vector;
+
+    if (check_start_tile && tile_occupancy_solid(p_occupancy, traversal.current_tile))
+    {
+      p_segment->result = RAYCAST_SUCCESS;
+      p_segment->impact = raycast_traversal_origin_impact(&traversal);
+      return RAYCAST_SUCCESS;
+    }
+
+    if (!segment_hit(&traversal, p_occupancy, &p_segment->impact))
+    {
+      p_segment->result = RAYCAST_MISS;
+      return RAYCAST_SUCCESS;
+    }
+    p_segment->result = RAYCAST_SUCCESS;
+
+    const SRaycastBounce next = bounce(p_context, p_segment);
+    const SImpactInformation impact = p_segment->impact;
+    const float length_left = 1.0f - impact.impact_time;
+    check_start_tile = false;
+
+    switch (next.type)
+    {
+      case RAYCAST_BOUNCE_REFLECT:
+      {
+        // Mirror the component across the hit edge, the reflected ray starts in the
+        // tile in front of the edge, which is the one the ray came from
+        const bool hit_vertical_edge = impact.impact_normal.x != 0;
+        const SVec2f reflected_vector = {
+          (hit_vertical_edge ? -traversal.vector.x : traversal.vector.x) * length_left,
+          (hit_vertical_edge ? traversal.vector.y : -traversal.vector.y) * length_left
+        };
+        const SVec2i tile_next_to_edge = hit_vertical_edge
+          ? (SVec2i) { impact.impact_tile.x + impact.impact_normal.x, impact.impact_tile.y }
+          : (SVec2i) { impact.impact_tile.x, impact.impact_tile.y + impact.impact_normal.y };
+        raycast_traversal_begin_in_tile(&traversal, p_grid, impact.impact_point, reflected_vector, tile_next_to_edge);
+        break;
+      }
+
+      case RAYCAST_BOUNCE_REFRACT:
+      {
+        const float length = sqrtf(traversal.vector.x * traversal.vector.x + traversal.vector.y * traversal.vector.y) * length_left;
+        raycast_traversal_begin_in_tile(&traversal, p_grid, impact.impact_point, scaled_direction(next.direction, length), impact.impact_tile);
+        break;
+      }
+
+      case RAYCAST_BOUNCE_PORTAL:
+      {
+        // A portal exit starts a fresh ray, which may well start inside a solid tile
+        const float length = sqrtf(traversal.vector.x * traversal.vector.x + traversal.vector.y * traversal.vector.y) * length_left;
+        if (!raycast_traversal_begin(&traversal, p_grid, next.origin, scaled_direction(next.direction, length))) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+        check_start_tile = true;
+        break;
+      }
+
+      default:
+        return RAYCAST_SUCCESS;
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef RAYCAST_BOUNCE_H
+#define RAYCAST_BOUNCE_H
+
+#include "raycast.h"
+
+// How the ray continues after a segment hit a solid tile
+typedef enum
+{
+  RAYCAST_BOUNCE_STOP,
+  // Mirrors the ray on the hit tile edge and continues from the impact point
+  RAYCAST_BOUNCE_REFLECT,
+  // Continues from the impact point through the hit tile along the direction, which
+  // has to point into the hit tile. The incoming direction passes straight through
+  RAYCAST_BOUNCE_REFRACT,
+  // Continues from the origin along the direction, the origin has to lie in the grid
+  RAYCAST_BOUNCE_PORTAL
+} ERaycastBounceType;
+
+// Origin and direction are only read where the type needs them. Directions can be of
+// any length, the continuation always covers the distance the ray has left
+typedef struct
+{
+  ERaycastBounceType type;
+  SVec2f origin;
+  SVec2f direction;
+} SRaycastBounce;
+
+// One straight piece of the ray. A segment that hit has RAYCAST_SUCCESS and its
+// impact, the last segment of a ray that ran out or left the grid has RAYCAST_MISS.
+// Impact times are relative to the segment vector
+typedef struct
+{
+  SVec2f origin;
+  SVec2f vector;
+  ERaycastResultType result;
+  SImpactInformation impact;
+} SRaycastSegment;
+
+typedef struct
+{
+  SRaycastSegment * p_segments;
+  int capacity;
+  int count;
+} SRaycastSegmentBuffer;
+
+// Decides how the ray goes on after the segment hit a solid tile
+typedef SRaycastBounce (*FRaycastBounce)(void * p_context, const SRaycastSegment * p_segment);
+
+// First hit query that goes on past its hits. Every hit asks the bounce callback
+// how to continue, a missing callback reflects off every hit, and the ray goes on
+// from there with the length it has left, so the ray vector is the length of the
+// whole chain. Each continuation starts a fresh traversal right in the tile next to
+// the impact point, without locating the origin again. Segments are written in
+// order until the ray stops, runs out, leaves the grid or fills the buffer, which
+// returns RAYCAST_BUFFER_EXHAUSTED and bounds the number of bounces. A segment
+// starting inside a solid tile hits it at time zero with a zero normal and ends
+// the ray. Returns RAYCAST_ORIGIN_OUT_OF_BOUNDS when the origin or a portal exit
+// lies outside the grid, keeping the segments before that, and
+// RAYCAST_OCCUPANCY_MISMATCH without any segments when the occupancy holds the
+// tiles of another grid size
+ERaycastResultType raycast_first_hit_segments
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  FRaycastBounce bounce,
+  void * p_context,
+  SRaycastSegmentBuffer * p_out_segments
+);
+
+#endif
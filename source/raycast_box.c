@@ -0,0 +1,166 @@
+#include "raycast_box.h"
+#include <math.h>
+
+// Stepping state of the leading box edge on one axis, relative to the grid origin.
+// Same parametric stepping as the ray traversal, the edge crosses a tile edge every
+// intersect_time_per_tile and enters first_tile_entered on the first crossing
+typedef struct
+{
+  int direction;
+  int first_tile_entered;
+  int edges_crossed;
+  double intersect_time_initial;
+  double intersect_time_per_tile;
+} SBoxAxisSweep;
+
+static int double_direction(double value)
+{
+  return value > 0.0 ? 1 : (value < 0.0 ? -1 : 0);
+}
+
+static SBoxAxisSweep box_axis_sweep(double box_min, double box_max, double vector, int tile_size)
+{
+  const int direction = double_direction(vector);
+
+  // An edge lying on a tile edge already touches the tile ahead of it at time zero
+  if (direction > 0)
+  {
+    const int first_tile_entered = (int)ceil(box_max / tile_size);
+    return (SBoxAxisSweep) {
+      direction, first_tile_entered, 0,
+      ((double)first_tile_entered * tile_size - box_max) / vector,
+      tile_size / vector
+    };
+  }
+
+  if (direction < 0)
+  {
+    const int first_tile_entered = (int)floor(box_min / tile_size) - 1;
+    return (SBoxAxisSweep) {
+      direction, first_tile_entered, 0,
+      ((double)(first_tile_entered + 1) * tile_size - box_min) / vector,
+      tile_size / -vector
+    };
+  }
+
+  return (SBoxAxisSweep) { 0, 0, 0, INFINITY, 0.0 };
+}
+
+// Tiles on one axis the box overlaps. Touching a tile with the leading edge counts
+// as overlapping it, touching it with the trailing edge does not, so a box sliding
+// along tiles never catches on them but does catch a corner it moves into
+static void box_tile_range
+(
+  double box_min,
+  double box_max,
+  int direction,
+  int tile_size,
+  int tiles_on_axis,
+  int * p_first_tile,
+  int * p_last_tile
+)
+{
+  const double first_tile = direction < 0 ? ceil(box_min / tile_size) - 1.0 : floor(box_min / tile_size);
+  const double last_tile = direction > 0 ? floor(box_max / tile_size) : ceil(box_max / tile_size) - 1.0;
+
+  *p_first_tile = first_tile > 0.0 ? (int)first_tile : 0;
+  *p_last_tile = last_tile < tiles_on_axis - 1 ? (int)last_tile : tiles_on_axis - 1;
+}
+
+static double box_axis_sweep_next_time(const SBoxAxisSweep * p_sweep, int tiles_on_axis)
+{
+  const int next_tile = p_sweep->first_tile_entered + p_sweep->direction * p_sweep->edges_crossed;
+
+  // The leading edge leaving the grid ends the sweep on its axis, the remaining
+  // box can still enter tiles on the other axis
+  if (p_sweep->direction == 0 || next_tile < 0 || next_tile >= tiles_on_axis) return INFINITY;
+
+  return p_sweep->intersect_time_initial + p_sweep->intersect_time_per_tile * p_sweep->edges_crossed;
+}
+
+static SAABB4f moved_box(SAABB4f box, SVec2f vector, float time)
+{
+  return (SAABB4f) {
+    { box.min.x + vector.x * time, box.min.y + vector.y * time },
+    { box.max.x + vector.x * time, box.max.y + vector.y * time }
+  };
+}
+
+ERaycastResultType raycast_box_first_hit
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SAABB4f box,
+  SVec2f vector,
+  SBoxImpactInformation * p_out_hit
+)
+{
+  const SVec2i tile_dimensions = p_grid->tile_dimensions;
+  const SVec2i tiles_on_axis = p_grid->tiles_on_axis;
+
+  // Set up in double precision and relative to the grid origin
+  const SVec2d box_min = { (double)box.min.x - p_grid->origin_bottom_left.x, (double)box.min.y - p_grid->origin_bottom_left.y };
+  const SVec2d box_max = { (double)box.max.x - p_grid->origin_bottom_left.x, (double)box.max.y - p_grid->origin_bottom_left.y };
+
+  const bool box_out_of_bounds =
+    !(box_min.x >= 0.0 && box_min.x <= box_max.x && box_max.x <= (double)tiles_on_axis.x * tile_dimensions.x) ||
+    !(box_min.y >= 0.0 && box_min.y <= box_max.y && box_max.y <= (double)tiles_on_axis.y * tile_dimensions.y);
+  if (box_out_of_bounds) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  // A box starting inside solid tiles is blocked right where it starts
+  SVec2i first_tile, last_tile;
+  box_tile_range(box_min.x, box_max.x, 0, tile_dimensions.x, tiles_on_axis.x, &first_tile.x, &last_tile.x);
+  box_tile_range(box_min.y, box_max.y, 0, tile_dimensions.y, tiles_on_axis.y, &first_tile.y, &last_tile.y);
+
+  for (int tile_y = first_tile.y; tile_y <= last_tile.y; tile_y++)
+  {
+    for (int tile_x = first_tile.x; tile_x <= last_tile.x; tile_x++)
+    {
+      if (!tile_occupancy_solid(p_occupancy, (SVec2i) { tile_x, tile_y })) continue;
+
+      *p_out_hit = (SBoxImpactInformation) { 0.0f, box, { tile_x, tile_y }, { 0, 0 } };
+      return RAYCAST_SUCCESS;
+    }
+  }
+
+  SBoxAxisSweep sweep_x = box_axis_sweep(box_min.x, box_max.x, vector.x, tile_dimensions.x);
+  SBoxAxisSweep sweep_y = box_axis_sweep(box_min.y, box_max.y, vector.y, tile_dimensions.y);
+
+  for (;;)
+  {
+    // Same tie rule as the ray traversal, the vertical edge goes first
+    const SVec2d next_times = { box_axis_sweep_next_time(&sweep_x, tiles_on_axis.x), box_axis_sweep_next_time(&sweep_y, tiles_on_axis.y) };
+    const bool crosses_vertical_edge = next_times.x <= next_times.y;
+    const double time = crosses_vertical_edge ? next_times.x : next_times.y;
+
+    // Stop when the box stops short of the next tile edge
+    if (!(time <= 1.0)) return RAYCAST_MISS;
+
+    // The leading edge enters a whole column or row of tiles, namely those the box
+    // overlaps on the other axis at that time
+    SVec2i impact_normal;
+    if (crosses_vertical_edge)
+    {
+      first_tile.x = last_tile.x = sweep_x.first_tile_entered + sweep_x.direction * sweep_x.edges_crossed++;
+      box_tile_range(box_min.y + vector.y * time, box_max.y + vector.y * time, sweep_y.direction, tile_dimensions.y, tiles_on_axis.y, &first_tile.y, &last_tile.y);
+      impact_normal = (SVec2i) { -sweep_x.direction, 0 };
+    }
+    else
+    {
+      first_tile.y = last_tile.y = sweep_y.first_tile_entered + sweep_y.direction * sweep_y.edges_crossed++;
+      box_tile_range(box_min.x + vector.x * time, box_max.x + vector.x * time, sweep_x.direction, tile_dimensions.x, tiles_on_axis.x, &first_tile.x, &last_tile.x);
+      impact_normal = (SVec2i) { 0, -sweep_y.direction };
+    }
+
+    for (int tile_y = first_tile.y; tile_y <= last_tile.y; tile_y++)
+    {
+      for (int tile_x = first_tile.x; tile_x <= last_tile.x; tile_x++)
+      {
+        if (!tile_occupancy_solid(p_occupancy, (SVec2i) { tile_x, tile_y })) continue;
+
+        *p_out_hit = (SBoxImpactInformation) { (float)time, moved_box(box, vector, (float)time), { tile_x, tile_y }, impact_normal };
+        return RAYCAST_SUCCESS;
+      }
+    }
+  }
+}
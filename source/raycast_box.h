@@ -0,0 +1,30 @@
+#ifndef RAYCAST_BOX_H
+#define RAYCAST_BOX_H
+
+#include "raycast.h"
+
+// The box as it touches the impact tile, and the normal of the tile edge it touches.
+// Boxes that already overlap a solid tile hit it at time zero with a zero normal
+typedef struct {
+  float impact_time;
+  SAABB4f impact_box;
+  SVec2i impact_tile;
+  SVec2i impact_normal;
+} SBoxImpactInformation;
+
+// Sweeps an axis aligned box along the vector and stops at the first solid tile it
+// touches. Tiles are visited in time order as the leading box edges cross tile
+// edges, so every tile the swept box covers is considered, corners included.
+// Merely sliding along a tile edge does not touch the tile. The box has to lie
+// inside the grid, else RAYCAST_ORIGIN_OUT_OF_BOUNDS. Returns RAYCAST_MISS when
+// the box moves all the way without touching a solid tile
+ERaycastResultType raycast_box_first_hit
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SAABB4f box,
+  SVec2f vector,
+  SBoxImpactInformation * p_out_hit
+);
+
+#endif
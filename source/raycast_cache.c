@@ -0,0 +1,176 @@
+#include "raycast_cache.h"
+#include "raycast_traversal.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Entries a key may land in, starting at its hashed slot
+#define CACHE_PROBE_LENGTH 4
+
+// Path block count of entries depending on every tile of the occupancy
+#define PATH_BLOCKS_OVERFLOWED -1
+
+static uint32_t float_bits(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static uint32_t hash_key(const uint32_t key[4])
+{
+  uint64_t hash = 0;
+  for (int word = 0; word < 4; word++)
+  {
+    hash = (hash ^ key[word]) * UINT64_C(0x9E3779B97F4A7C15);
+    hash ^= hash >> 29;
+  }
+
+  return (uint32_t)(hash >> 32);
+}
+
+static void record_path_block(SRaycastCacheEntry * p_entry, const STileOccupancy * p_occupancy, SVec2i tile)
+{
+  if (p_entry->path_block_count == PATH_BLOCKS_OVERFLOWED) return;
+
+  const uint32_t block = (uint32_t)tile_occupancy_version_block_index(p_occupancy, tile);
+  if (p_entry->path_block_count > 0 && p_entry->path_blocks[p_entry->path_block_count - 1] == block) return;
+
+  if (p_entry->path_block_count == RAYCAST_CACHE_PATH_BLOCKS)
+  {
+    p_entry->path_block_count = PATH_BLOCKS_OVERFLOWED;
+    return;
+  }
+
+  p_entry->path_blocks[p_entry->path_block_count] = block;
+  p_entry->path_block_versions[p_entry->path_block_count] = p_occupancy->p_block_versions[block];
+  p_entry->path_block_count++;
+}
+
+static bool entry_current(const SRaycastCacheEntry * p_entry, const STileOccupancy * p_occupancy)
+{
+  if (p_entry->path_block_count == PATH_BLOCKS_OVERFLOWED) return p_entry->occupancy_version == p_occupancy->version;
+
+  for (int path_block = 0; path_block < p_entry->path_block_count; path_block++)
+  {
+    if (p_occupancy->p_block_versions[p_entry->path_blocks[path_block]] != p_entry->path_block_versions[path_block]) return false;
+  }
+
+  return true;
+}
+
+// Same traversal as raycast_first_hit(), which also notes every tile block the ray
+// passes through on its way to the hit. Skips never leave the block they start in,
+// so each of those blocks holds a tile the traversal stands on
+static ERaycastResultType first_hit_recording_path
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  SRaycastCacheEntry * p_entry
+)
+{
+  p_entry->path_block_count = 0;
+
+  SRaycastTraversal traversal;
+  if (!raycast_traversal_begin(&traversal, p_grid, origin, vector)) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  record_path_block(p_entry, p_occupancy, traversal.current_tile);
+  if (tile_occupancy_solid(p_occupancy, traversal.current_tile))
+  {
+    p_entry->hit = raycast_traversal_origin_impact(&traversal);
+    return RAYCAST_SUCCESS;
+  }
+
+  SImpactInformation impact;
+  for (;;)
+  {
+    const int block_shift = tile_occupancy_empty_block_shift(p_occupancy, traversal.current_tile);
+    if (block_shift > 0)
+    {
+      if (!raycast_traversal_skip_block(&traversal, block_shift)) return RAYCAST_MISS;
+      record_path_block(p_entry, p_occupancy, traversal.current_tile);
+    }
+
+    if (!raycast_traversal_step(&traversal, &impact)) return RAYCAST_MISS;
+    record_path_block(p_entry, p_occupancy, impact.impact_tile);
+
+    if (tile_occupancy_solid(p_occupancy, impact.impact_tile))
+    {
+      impact.exit_time = raycast_traversal_exit_time(&traversal);
+      p_entry->hit = impact;
+      return RAYCAST_SUCCESS;
+    }
+  }
+}
+
+bool raycast_cache_create(SRaycastCache * p_cache, int entry_count)
+{
+  uint32_t capacity = CACHE_PROBE_LENGTH;
+  while (capacity < (uint32_t)entry_count && capacity < (UINT32_C(1) << 30)) capacity <<= 1;
+
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  *p_cache = (SRaycastCache) { calloc(capacity, sizeof(SRaycastCacheEntry)), capacity - 1 };
+  return p_cache->p_entries != NULL;
+}
+
+void raycast_cache_destroy(SRaycastCache * p_cache)
+{
+  free(p_cache->p_entries);
+  *p_cache = (SRaycastCache) { NULL, 0 };
+}
+
+void raycast_cache_clear(SRaycastCache * p_cache)
+{
+  memset(p_cache->p_entries, 0, sizeof(SRaycastCacheEntry) * ((size_t)p_cache->entry_mask + 1));
+}
+
+ERaycastResultType raycast_first_hit_cached
+(
+  SRaycastCache * p_cache,
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+)
+{
+  if (!tile_occupancy_matches_grid(p_occupancy, p_grid)) return RAYCAST_OCCUPANCY_MISMATCH;
+
+  // Served from the cache or not, every call is one ray cast
+  PROFILE_COUNT(PROFILE_COUNTER_RAYS_CAST, 1);
+
+  // Keyed on the exact bits, so only the very same ray is served from the cache
+  const uint32_t key[4] = { float_bits(origin.x), float_bits(origin.y), float_bits(vector.x), float_bits(vector.y) };
+  const uint32_t home_slot = hash_key(key);
+
+  // Reuse the entry of the same ray or else an empty one, and evict the entry in
+  // the home slot when the whole probe is taken by other rays
+  SRaycastCacheEntry * p_entry = &p_cache->p_entries[home_slot & p_cache->entry_mask];
+  for (uint32_t probe = 0; probe < CACHE_PROBE_LENGTH; probe++)
+  {
+    SRaycastCacheEntry * const p_candidate = &p_cache->p_entries[(home_slot + probe) & p_cache->entry_mask];
+    const bool same_ray = p_candidate->occupied && memcmp(p_candidate->key, key, sizeof(key)) == 0;
+
+    if (same_ray && entry_current(p_candidate, p_occupancy))
+    {
+      if (p_candidate->result == RAYCAST_SUCCESS) *p_out_hit = p_candidate->hit;
+      return p_candidate->result;
+    }
+
+    if (same_ray || !p_candidate->occupied)
+    {
+      p_entry = p_candidate;
+      break;
+    }
+  }
+
+  memcpy(p_entry->key, key, sizeof(key));
+  p_entry->occupied = true;
+  p_entry->occupancy_version = p_occupancy->version;
+  p_entry->result = first_hit_recording_path(p_grid, p_occupancy, origin, vector, p_entry);
+
+  if (p_entry->result == RAYCAST_SUCCESS) *p_out_hit = p_entry->hit;
+  return p_entry->result;
+}
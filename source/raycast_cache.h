@@ -0,0 +1,53 @@
+#ifndef RAYCAST_CACHE_H
+#define RAYCAST_CACHE_H
+
+#include "raycast.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Rays crossing more 64x64 tile blocks than this are revalidated against the version
+// of the whole occupancy instead, so any tile change recasts them
+#define RAYCAST_CACHE_PATH_BLOCKS 6
+
+typedef struct
+{
+  uint32_t key[4];
+  bool occupied;
+  ERaycastResultType result;
+  SImpactInformation hit;
+  uint64_t occupancy_version;
+  int path_block_count;
+  uint32_t path_blocks[RAYCAST_CACHE_PATH_BLOCKS];
+  uint32_t path_block_versions[RAYCAST_CACHE_PATH_BLOCKS];
+} SRaycastCacheEntry;
+
+// First hit results keyed by ray origin and vector. Every entry remembers the
+// versions of the tile blocks its ray crossed up to the hit, and stays valid until
+// a tile in one of those blocks changes, so rays cast again and again from the same
+// place cost a hash lookup and a few version compares while the map stays the same
+// along their path. A cache serves one grid and occupancy, clear it when switching
+typedef struct
+{
+  SRaycastCacheEntry * p_entries;
+  uint32_t entry_mask;
+} SRaycastCache;
+
+// Room for at least the given number of entries, rounded up to a power of two
+bool raycast_cache_create(SRaycastCache * p_cache, int entry_count);
+void raycast_cache_destroy(SRaycastCache * p_cache);
+void raycast_cache_clear(SRaycastCache * p_cache);
+
+// Same result as raycast_first_hit(), served from the cache while still current.
+// Block versions are looked up by tile, so an occupancy of another size than the
+// grid returns RAYCAST_OCCUPANCY_MISMATCH without touching the cache
+ERaycastResultType raycast_first_hit_cached
+(
+  SRaycastCache * p_cache,
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  SVec2f vector,
+  SImpactInformation * p_out_hit
+);
+
+#endif
@@ -0,0 +1,173 @@
+#include "raycast_fixed.h"
+
+// Exact running quotient of a numerator that grows by a fixed step, so the
+// stepping never divides
+typedef struct
+{
+  int64_t quotient;
+  int64_t remainder;
+  int64_t quotient_per_step;
+  int64_t remainder_per_step;
+  int64_t divisor;
+} SFixedQuotient;
+
+// Stepping state of one axis. Distances are along the axis from the ray origin
+// to the next edge in ray direction, in 16.16 fixed point pixels
+typedef struct
+{
+  int direction;
+  int64_t length;
+  int64_t edge_distance;
+  int64_t tile_size;
+  int64_t crossing_order;
+  int64_t crossing_order_per_tile;
+  SFixedQuotient impact_time;
+  SFixedQuotient other_axis_offset;
+} SFixedAxisTraversal;
+
+static SFixedQuotient fixed_quotient(int64_t numerator, int64_t numerator_per_step, int64_t divisor)
+{
+  return (SFixedQuotient) {
+    numerator / divisor,
+    numerator % divisor,
+    numerator_per_step / divisor,
+    numerator_per_step % divisor,
+    divisor
+  };
+}
+
+static void fixed_quotient_step(SFixedQuotient * p_quotient)
+{
+  p_quotient->remainder += p_quotient->remainder_per_step;
+
+  // The carry follows the ray direction rather than any pattern, compute it without
+  // a branch the predictor would miss half of the time
+  const int64_t carry = p_quotient->remainder >= p_quotient->divisor;
+  p_quotient->remainder -= carry * p_quotient->divisor;
+  p_quotient->quotient += p_quotient->quotient_per_step + carry;
+}
+
+static int64_t floor_divide(int64_t dividend, int64_t divisor)
+{
+  const int64_t quotient = dividend / divisor;
+  return quotient * divisor > dividend ? quotient - 1 : quotient;
+}
+
+static int fixed_direction(int32_t value)
+{
+  return value > 0 ? 1 : (value < 0 ? -1 : 0);
+}
+
+static SFixedAxisTraversal fixed_axis_traversal
+(
+  int64_t grid_relative_origin,
+  int32_t vector,
+  int32_t other_vector,
+  int64_t tile_size,
+  int origin_tile
+)
+{
+  // An axis parallel to the ray is ordered behind every crossing of the other axis
+  // and its first edge lies beyond the ray end, so it is never crossed
+  SFixedAxisTraversal axis = { fixed_direction(vector), 0, 1, tile_size, INT64_MAX, 0, { 0, 0, 0, 0, 1 }, { 0, 0, 0, 0, 1 } };
+  if (axis.direction == 0) return axis;
+
+  const int64_t other_length = other_vector < 0 ? -(int64_t)other_vector : other_vector;
+  axis.length = vector < 0 ? -(int64_t)vector : vector;
+  axis.edge_distance = axis.direction > 0 ?
+    (origin_tile + 1) * tile_size - grid_relative_origin :
+    grid_relative_origin - origin_tile * tile_size;
+
+  // Crossings on both axis are ordered by comparing distance over length
+  // cross multiplied, which keeps the order exact without ever dividing
+  axis.crossing_order = axis.edge_distance * other_length;
+  axis.crossing_order_per_tile = tile_size * other_length;
+  axis.impact_time = fixed_quotient(axis.edge_distance * RAYCAST_FIXED_ONE, tile_size * RAYCAST_FIXED_ONE, axis.length);
+  axis.other_axis_offset = fixed_quotient(axis.crossing_order, axis.crossing_order_per_tile, axis.length);
+
+  return axis;
+}
+
+static void fixed_axis_traversal_step(SFixedAxisTraversal * p_axis)
+{
+  p_axis->edge_distance += p_axis->tile_size;
+  p_axis->crossing_order += p_axis->crossing_order_per_tile;
+  fixed_quotient_step(&p_axis->impact_time);
+  fixed_quotient_step(&p_axis->other_axis_offset);
+}
+
+static bool tile_out_of_bounds(SVec2i tiles_on_axis, SVec2i tile)
+{
+  return
+    tile.x < 0 || tile.x >= tiles_on_axis.x ||
+    tile.y < 0 || tile.y >= tiles_on_axis.y;
+}
+
+ERaycastResultType raycast_grid_fixed
+(
+  const SGrid * p_grid,
+  SVec2x origin,
+  SVec2x vector,
+  SFixedImpactBuffer * p_out_buffer
+)
+{
+  p_out_buffer->count = 0;
+
+  const int64_t tile_size_x = (int64_t)p_grid->tile_dimensions.x * RAYCAST_FIXED_ONE;
+  const int64_t tile_size_y = (int64_t)p_grid->tile_dimensions.y * RAYCAST_FIXED_ONE;
+  const int64_t raycast_grid_relative_origin_x = origin.x - (int64_t)p_grid->origin_bottom_left.x * RAYCAST_FIXED_ONE;
+  const int64_t raycast_grid_relative_origin_y = origin.y - (int64_t)p_grid->origin_bottom_left.y * RAYCAST_FIXED_ONE;
+  const int64_t raycast_tile_origin_x = floor_divide(raycast_grid_relative_origin_x, tile_size_x);
+  const int64_t raycast_tile_origin_y = floor_divide(raycast_grid_relative_origin_y, tile_size_y);
+
+  // Consider raycast only when ray origin inside the grid
+  const bool origin_out_of_bounds =
+    raycast_tile_origin_x < 0 || raycast_tile_origin_x >= p_grid->tiles_on_axis.x ||
+    raycast_tile_origin_y < 0 || raycast_tile_origin_y >= p_grid->tiles_on_axis.y;
+  if (origin_out_of_bounds) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  SVec2i current_tile = { (int)raycast_tile_origin_x, (int)raycast_tile_origin_y };
+  SFixedAxisTraversal axis_x = fixed_axis_traversal(raycast_grid_relative_origin_x, vector.x, vector.y, tile_size_x, current_tile.x);
+  SFixedAxisTraversal axis_y = fixed_axis_traversal(raycast_grid_relative_origin_y, vector.y, vector.x, tile_size_y, current_tile.y);
+
+  // Same single pass stepping as raycast_grid() with the same tie rule, the
+  // vertical edge goes first
+  for (;;)
+  {
+    SFixedImpactInformation impact;
+
+    // Stop stepping when the impact is further than the ray can reach, and snap the
+    // crossed axis onto the exact edge while the other one follows the ray
+    if (axis_x.crossing_order <= axis_y.crossing_order)
+    {
+      if (axis_x.edge_distance > axis_x.length) return RAYCAST_SUCCESS;
+
+      current_tile.x += axis_x.direction;
+      impact.impact_time = (int32_t)axis_x.impact_time.quotient;
+      impact.impact_point = (SVec2x) {
+        (int32_t)(origin.x + axis_x.direction * axis_x.edge_distance),
+        (int32_t)(origin.y + axis_y.direction * axis_x.other_axis_offset.quotient)
+      };
+      fixed_axis_traversal_step(&axis_x);
+    }
+    else
+    {
+      if (axis_y.edge_distance > axis_y.length) return RAYCAST_SUCCESS;
+
+      current_tile.y += axis_y.direction;
+      impact.impact_time = (int32_t)axis_y.impact_time.quotient;
+      impact.impact_point = (SVec2x) {
+        (int32_t)(origin.x + axis_x.direction * axis_y.other_axis_offset.quotient),
+        (int32_t)(origin.y + axis_y.direction * axis_y.edge_distance)
+      };
+      fixed_axis_traversal_step(&axis_y);
+    }
+    impact.impact_tile = current_tile;
+
+    // Stop stepping when the ray leaves the grid
+    if (tile_out_of_bounds(p_grid->tiles_on_axis, current_tile)) return RAYCAST_SUCCESS;
+
+    if (p_out_buffer->count == p_out_buffer->capacity) return RAYCAST_BUFFER_EXHAUSTED;
+    p_out_buffer->p_impacts[p_out_buffer->count++] = impact;
+  }
+}
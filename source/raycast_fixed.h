@@ -0,0 +1,37 @@
+#ifndef RAYCAST_FIXED_H
+#define RAYCAST_FIXED_H
+
+#include "raycast.h"
+
+#define RAYCAST_FIXED_SHIFT 16
+#define RAYCAST_FIXED_ONE (1 << RAYCAST_FIXED_SHIFT)
+
+// Impact time in 16.16 fixed point from zero to RAYCAST_FIXED_ONE at the ray end.
+// The impact point is exact on the crossed edge, the other axis is rounded towards
+// the ray origin
+typedef struct {
+  int32_t impact_time;
+  SVec2x impact_point;
+  SVec2i impact_tile;
+} SFixedImpactInformation;
+
+typedef struct
+{
+  SFixedImpactInformation * p_impacts;
+  int capacity;
+  int count;
+} SFixedImpactBuffer;
+
+// Integer only twin of raycast_grid() for lockstep simulations. Origin and vector
+// are 16.16 fixed point pixels and every step is integer additions and compares,
+// so the same inputs produce bit identical impacts on every compiler, flag set and
+// machine. Tile dimensions must stay below 32768 pixels
+ERaycastResultType raycast_grid_fixed
+(
+  const SGrid * p_grid,
+  SVec2x origin,
+  SVec2x vector,
+  SFixedImpactBuffer * p_out_buffer
+);
+
+#endif
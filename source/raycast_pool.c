@@ -0,0 +1,256 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "raycast_pool.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Chunks are sized so the hit lists one chunk writes fit the level one data cache
+#define CHUNK_RESULT_BYTES (32 * 1024)
+
+// Chunks stay a multiple of the widest batch kernel so no lane runs empty
+#define CHUNK_RAY_MULTIPLE 8
+
+// Enough chunks per thread that stealing can even out rays of different lengths
+#define MIN_CHUNKS_PER_THREAD 4
+
+static uint64_t pack_chunk_range(uint32_t begin, uint32_t end)
+{
+  return ((uint64_t)end << 32) | begin;
+}
+
+static bool take_own_chunk(SRaycastChunkDeque * p_deque, int * p_chunk)
+{
+  uint64_t range = __atomic_load_n(&p_deque->range, __ATOMIC_ACQUIRE);
+
+  for (;;)
+  {
+    const uint32_t begin = (uint32_t)range;
+    const uint32_t end = (uint32_t)(range >> 32);
+    if (begin >= end) return false;
+
+    if (__atomic_compare_exchange_n(&p_deque->range, &range, pack_chunk_range(begin + 1, end), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      *p_chunk = (int)begin;
+      return true;
+    }
+  }
+}
+
+static bool steal_chunk(SRaycastChunkDeque * p_deque, int * p_chunk)
+{
+  uint64_t range = __atomic_load_n(&p_deque->range, __ATOMIC_ACQUIRE);
+
+  for (;;)
+  {
+    const uint32_t begin = (uint32_t)range;
+    const uint32_t end = (uint32_t)(range >> 32);
+    if (begin >= end) return false;
+
+    if (__atomic_compare_exchange_n(&p_deque->range, &range, pack_chunk_range(begin, end - 1), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      *p_chunk = (int)(end - 1);
+      return true;
+    }
+  }
+}
+
+static void cast_chunk(const SRaycastPool * p_pool, int chunk)
+{
+  const int first_ray = chunk * p_pool->chunk_rays;
+  const int remaining_rays = p_pool->p_batch->count - first_ray;
+  const SRayBatch * const p_batch = p_pool->p_batch;
+  const SRayBatchResults * const p_results = p_pool->p_results;
+
+  const SRayBatch chunk_batch = {
+    p_batch->p_origin_x + first_ray,
+    p_batch->p_origin_y + first_ray,
+    p_batch->p_vector_x + first_ray,
+    p_batch->p_vector_y + first_ray,
+    remaining_rays < p_pool->chunk_rays ? remaining_rays : p_pool->chunk_rays
+  };
+  SRayBatchResults chunk_results = {
+    p_results->p_impacts + (size_t)first_ray * p_results->impacts_per_ray,
+    p_results->impacts_per_ray,
+    p_results->p_impact_counts + first_ray,
+    p_results->p_results + first_ray
+  };
+
+  raycast_grid_batch(p_pool->p_grid, &chunk_batch, &chunk_results);
+}
+
+// Casts the own chunks first, then steals from the other workers until every deque
+// is empty. Chunks are never added while a batch runs, so empty deques mean done
+static void work_on_batch(SRaycastPool * p_pool, int worker_index)
+{
+  int chunk;
+
+  while (take_own_chunk(&p_pool->p_deques[worker_index], &chunk)) cast_chunk(p_pool, chunk);
+
+  for (int offset = 1; offset < p_pool->thread_count; offset++)
+  {
+    SRaycastChunkDeque * const p_victim = &p_pool->p_deques[(worker_index + offset) % p_pool->thread_count];
+    while (steal_chunk(p_victim, &chunk)) cast_chunk(p_pool, chunk);
+  }
+}
+
+typedef struct
+{
+  SRaycastPool * p_pool;
+  int worker_index;
+} SWorkerStart;
+
+static void * worker_main(void * p_argument)
+{
+  const SWorkerStart start = *(SWorkerStart *)p_argument;
+  SRaycastPool * const p_pool = start.p_pool;
+  free(p_argument);
+
+  // No batch is posted before the pool is created, so a worker that starts late
+  // still picks up the first batch
+  unsigned seen_generation = 0;
+
+  pthread_mutex_lock(&p_pool->mutex);
+
+  for (;;)
+  {
+    while (p_pool->batch_generation == seen_generation && !p_pool->shutting_down)
+    {
+      pthread_cond_wait(&p_pool->batch_posted, &p_pool->mutex);
+    }
+    if (p_pool->shutting_down) break;
+
+    seen_generation = p_pool->batch_generation;
+    pthread_mutex_unlock(&p_pool->mutex);
+
+    work_on_batch(p_pool, start.worker_index);
+
+    pthread_mutex_lock(&p_pool->mutex);
+    if (++p_pool->finished_threads == p_pool->thread_count - 1) pthread_cond_signal(&p_pool->batch_finished);
+  }
+
+  pthread_mutex_unlock(&p_pool->mutex);
+  return NULL;
+}
+
+static void stop_workers(SRaycastPool * p_pool, int started_workers)
+{
+  pthread_mutex_lock(&p_pool->mutex);
+  p_pool->shutting_down = true;
+  pthread_cond_broadcast(&p_pool->batch_posted);
+  pthread_mutex_unlock(&p_pool->mutex);
+
+  for (int worker_index = 1; worker_index <= started_workers; worker_index++)
+  {
+    pthread_join(p_pool->p_threads[worker_index - 1], NULL);
+  }
+}
+
+bool raycast_pool_create(SRaycastPool * p_pool, int thread_count)
+{
+  if (thread_count <= 0)
+  {
+    const long online_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = online_cores > 0 ? (int)online_cores : 1;
+  }
+
+  *p_pool = (SRaycastPool) { .thread_count = thread_count };
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 2);
+  p_pool->p_threads = malloc(sizeof(pthread_t) * thread_count);
+  p_pool->p_deques = calloc(thread_count, sizeof(SRaycastChunkDeque));
+  if (p_pool->p_threads == NULL || p_pool->p_deques == NULL)
+  {
+    free(p_pool->p_threads);
+    free(p_pool->p_deques);
+    return false;
+  }
+
+  pthread_mutex_init(&p_pool->mutex, NULL);
+  pthread_cond_init(&p_pool->batch_posted, NULL);
+  pthread_cond_init(&p_pool->batch_finished, NULL);
+
+  // The creating thread is worker zero, only the others get a thread of their own
+  for (int worker_index = 1; worker_index < thread_count; worker_index++)
+  {
+    PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+    SWorkerStart * const p_start = malloc(sizeof(SWorkerStart));
+    if (p_start != NULL) *p_start = (SWorkerStart) { p_pool, worker_index };
+
+    const bool started =
+      p_start != NULL &&
+      pthread_create(&p_pool->p_threads[worker_index - 1], NULL, worker_main, p_start) == 0;
+
+    if (!started)
+    {
+      free(p_start);
+      p_pool->thread_count = worker_index;
+      raycast_pool_destroy(p_pool);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void raycast_pool_destroy(SRaycastPool * p_pool)
+{
+  stop_workers(p_pool, p_pool->thread_count - 1);
+
+  pthread_cond_destroy(&p_pool->batch_finished);
+  pthread_cond_destroy(&p_pool->batch_posted);
+  pthread_mutex_destroy(&p_pool->mutex);
+  free(p_pool->p_deques);
+  free(p_pool->p_threads);
+  *p_pool = (SRaycastPool) { 0 };
+}
+
+void raycast_pool_cast_batch
+(
+  SRaycastPool * p_pool,
+  const SGrid * p_grid,
+  const SRayBatch * p_batch,
+  SRayBatchResults * p_results
+)
+{
+  if (p_batch->count <= 0) return;
+
+  // Shrink cache sized chunks further when the batch would not keep every thread busy
+  const size_t result_bytes_per_ray = (size_t)p_results->impacts_per_ray * sizeof(SImpactInformation);
+  int chunk_rays = (int)(CHUNK_RESULT_BYTES / (result_bytes_per_ray > 0 ? result_bytes_per_ray : 1));
+  const int balanced_chunk_rays = p_batch->count / (p_pool->thread_count * MIN_CHUNKS_PER_THREAD);
+  if (balanced_chunk_rays < chunk_rays) chunk_rays = balanced_chunk_rays;
+  chunk_rays -= chunk_rays % CHUNK_RAY_MULTIPLE;
+  if (chunk_rays < CHUNK_RAY_MULTIPLE) chunk_rays = CHUNK_RAY_MULTIPLE;
+
+  const int chunk_count = (p_batch->count - 1) / chunk_rays + 1;
+
+  p_pool->p_grid = p_grid;
+  p_pool->p_batch = p_batch;
+  p_pool->p_results = p_results;
+  p_pool->chunk_rays = chunk_rays;
+
+  // Every worker starts out owning a contiguous run of chunks
+  for (int worker_index = 0; worker_index < p_pool->thread_count; worker_index++)
+  {
+    const uint32_t begin = (uint32_t)((int64_t)chunk_count * worker_index / p_pool->thread_count);
+    const uint32_t end = (uint32_t)((int64_t)chunk_count * (worker_index + 1) / p_pool->thread_count);
+    __atomic_store_n(&p_pool->p_deques[worker_index].range, pack_chunk_range(begin, end), __ATOMIC_RELEASE);
+  }
+
+  pthread_mutex_lock(&p_pool->mutex);
+  p_pool->batch_generation++;
+  p_pool->finished_threads = 0;
+  pthread_cond_broadcast(&p_pool->batch_posted);
+  pthread_mutex_unlock(&p_pool->mutex);
+
+  work_on_batch(p_pool, 0);
+
+  // Wait for every worker to leave the batch, not just for the last chunk, so no
+  // worker still reads the batch once the caller reuses it
+  pthread_mutex_lock(&p_pool->mutex);
+  while (p_pool->finished_threads < p_pool->thread_count - 1)
+  {
+    pthread_cond_wait(&p_pool->batch_finished, &p_pool->mutex);
+  }
+  pthread_mutex_unlock(&p_pool->mutex);
+}
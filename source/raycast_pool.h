@@ -0,0 +1,53 @@
+#ifndef RAYCAST_POOL_H
+#define RAYCAST_POOL_H
+
+#include "raycast_batch.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Chunk indices a worker still owns. The owner takes chunks from the front and
+// idle workers steal them from the back, both through the same packed range
+typedef struct
+{
+  uint64_t range;
+  unsigned char padding[56];
+} SRaycastChunkDeque;
+
+// Worker threads that cast the chunks of a ray batch in parallel. The thread
+// submitting a batch works along as the first worker, so a pool of one thread
+// casts everything on the caller thread. The workers keep a pointer to the pool,
+// so it must not move between create and destroy
+typedef struct
+{
+  int thread_count;
+  pthread_t * p_threads;
+  SRaycastChunkDeque * p_deques;
+  pthread_mutex_t mutex;
+  pthread_cond_t batch_posted;
+  pthread_cond_t batch_finished;
+  unsigned batch_generation;
+  int finished_threads;
+  bool shutting_down;
+  const SGrid * p_grid;
+  const SRayBatch * p_batch;
+  SRayBatchResults * p_results;
+  int chunk_rays;
+} SRaycastPool;
+
+// A thread count of zero uses one thread per online core
+bool raycast_pool_create(SRaycastPool * p_pool, int thread_count);
+void raycast_pool_destroy(SRaycastPool * p_pool);
+
+// Splits the batch into cache sized chunks of consecutive rays and returns once all
+// of them are cast. Every ray writes only its own hit list slice, so the results do
+// not depend on which worker cast which chunk
+void raycast_pool_cast_batch
+(
+  SRaycastPool * p_pool,
+  const SGrid * p_grid,
+  const SRayBatch * p_batch,
+  SRayBatchResults * p_results
+);
+
+#endif
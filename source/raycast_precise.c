@@ -0,0 +1,105 @@
+#include "raycast_precise.h"
+#include <math.h>
+
+static int double_direction(double value)
+{
+  return value > 0.0 ? 1 : (value < 0.0 ? -1 : 0);
+}
+
+static bool tile_out_of_bounds(SVec2i tiles_on_axis, SVec2i tile)
+{
+  return
+    tile.x < 0 || tile.x >= tiles_on_axis.x ||
+    tile.y < 0 || tile.y >= tiles_on_axis.y;
+}
+
+ERaycastResultType raycast_grid_precise
+(
+  const SGrid * p_grid,
+  SVec2d origin,
+  SVec2d vector,
+  SPreciseImpactBuffer * p_out_buffer
+)
+{
+  p_out_buffer->count = 0;
+
+  const SVec2i grid_origin = p_grid->origin_bottom_left;
+  const SVec2i tile_dimensions = p_grid->tile_dimensions;
+  const SVec2d raycast_grid_relative_origin = {
+    origin.x - grid_origin.x,
+    origin.y - grid_origin.y
+  };
+  const SVec2d raycast_tile_origin_exact = {
+    floor(raycast_grid_relative_origin.x / tile_dimensions.x),
+    floor(raycast_grid_relative_origin.y / tile_dimensions.y)
+  };
+
+  // Consider raycast only when ray origin inside the grid
+  const bool origin_out_of_bounds =
+    !(raycast_tile_origin_exact.x >= 0.0 && raycast_tile_origin_exact.x < p_grid->tiles_on_axis.x) ||
+    !(raycast_tile_origin_exact.y >= 0.0 && raycast_tile_origin_exact.y < p_grid->tiles_on_axis.y);
+  if (origin_out_of_bounds) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  SVec2i current_tile = { (int)raycast_tile_origin_exact.x, (int)raycast_tile_origin_exact.y };
+  const SVec2i raycast_direction = { double_direction(vector.x), double_direction(vector.y) };
+  const SVec2d tile_edge_in_ray_direction = {
+    (double)(raycast_direction.x > 0 ? current_tile.x + 1 : current_tile.x) * tile_dimensions.x,
+    (double)(raycast_direction.y > 0 ? current_tile.y + 1 : current_tile.y) * tile_dimensions.y
+  };
+
+  // Same single pass stepping as raycast_grid(), only every quantity is a double
+  const SVec2d intersect_times_initial = {
+    raycast_direction.x != 0 ? (tile_edge_in_ray_direction.x - raycast_grid_relative_origin.x) / vector.x : INFINITY,
+    raycast_direction.y != 0 ? (tile_edge_in_ray_direction.y - raycast_grid_relative_origin.y) / vector.y : INFINITY
+  };
+  const SVec2d intersect_time_per_tile = {
+    raycast_direction.x != 0 ? tile_dimensions.x / fabs(vector.x) : 0.0,
+    raycast_direction.y != 0 ? tile_dimensions.y / fabs(vector.y) : 0.0
+  };
+  const SVec2d edge_position_initial = {
+    grid_origin.x + tile_edge_in_ray_direction.x,
+    grid_origin.y + tile_edge_in_ray_direction.y
+  };
+  const SVec2d edge_position_per_tile = {
+    (double)raycast_direction.x * tile_dimensions.x,
+    (double)raycast_direction.y * tile_dimensions.y
+  };
+  SVec2i edges_crossed = { 0, 0 };
+
+  for (;;)
+  {
+    const SVec2d next_impact_times = {
+      intersect_times_initial.x + intersect_time_per_tile.x * edges_crossed.x,
+      intersect_times_initial.y + intersect_time_per_tile.y * edges_crossed.y
+    };
+    const bool crosses_vertical_edge = next_impact_times.x <= next_impact_times.y;
+    const double impact_time = crosses_vertical_edge ? next_impact_times.x : next_impact_times.y;
+
+    if (!(impact_time <= 1.0)) return RAYCAST_SUCCESS;
+
+    SVec2d impact_point;
+    if (crosses_vertical_edge)
+    {
+      current_tile.x += raycast_direction.x;
+      impact_point = (SVec2d) {
+        edge_position_initial.x + edge_position_per_tile.x * edges_crossed.x,
+        origin.y + vector.y * impact_time
+      };
+      edges_crossed.x++;
+    }
+    else
+    {
+      current_tile.y += raycast_direction.y;
+      impact_point = (SVec2d) {
+        origin.x + vector.x * impact_time,
+        edge_position_initial.y + edge_position_per_tile.y * edges_crossed.y
+      };
+      edges_crossed.y++;
+    }
+
+    if (tile_out_of_bounds(p_grid->tiles_on_axis, current_tile)) return RAYCAST_SUCCESS;
+
+    if (p_out_buffer->count == p_out_buffer->capacity) return RAYCAST_BUFFER_EXHAUSTED;
+    p_out_buffer->p_impacts[p_out_buffer->count++] = (SPreciseImpactInformation) { impact_time, impact_point, current_tile };
+  }
+}
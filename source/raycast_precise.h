@@ -0,0 +1,30 @@
+#ifndef RAYCAST_PRECISE_H
+#define RAYCAST_PRECISE_H
+
+#include "raycast.h"
+
+typedef struct {
+  double impact_time;
+  SVec2d impact_point;
+  SVec2i impact_tile;
+} SPreciseImpactInformation;
+
+typedef struct
+{
+  SPreciseImpactInformation * p_impacts;
+  int capacity;
+  int count;
+} SPreciseImpactBuffer;
+
+// Double precision twin of raycast_grid() for worlds far larger than a screen.
+// Impact points stay exact to well below a pixel millions of tiles away from the
+// grid origin and along rays crossing millions of tiles
+ERaycastResultType raycast_grid_precise
+(
+  const SGrid * p_grid,
+  SVec2d origin,
+  SVec2d vector,
+  SPreciseImpactBuffer * p_out_buffer
+);
+
+#endif
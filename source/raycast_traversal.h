@@ -0,0 +1,328 @@
+#ifndef RAYCAST_TRAVERSAL_H
+#define RAYCAST_TRAVERSAL_H
+
+// Library internal - The single pass traversal state shared by all raycast entry
+// points. No public header includes it, cursors keep their traversal in a state
+// of fixed size instead
+
+#include "datatypes.h"
+#include "helpers.h"
+#include <stdbool.h>
+#include <math.h>
+
+typedef struct
+{
+  SVec2f origin;
+  SVec2f vector;
+  SVec2i tiles_on_axis;
+  SVec2i direction;
+  SVec2i current_tile;
+  SVec2i edges_crossed;
+  SVec2f intersect_times_initial;
+  SVec2f intersect_time_per_tile;
+  SVec2f edge_position_initial;
+  SVec2f edge_position_per_tile;
+} SRaycastTraversal;
+
+// Starts the traversal in the given tile, which has to hold the origin or have it on
+// one of its edges. Continuations of a ray from an impact point start this way, as
+// the impact point lies on the edge between two tiles
+static inline void raycast_traversal_begin_in_tile
+(
+  SRaycastTraversal * p_traversal,
+  const SGrid * p_grid,
+  SVec2f origin,
+  SVec2f vector,
+  SVec2i tile
+)
+{
+  const SVec2i grid_origin = p_grid->origin_bottom_left;
+  const SVec2i tile_dimensions = p_grid->tile_dimensions;
+  const SVec2d raycast_grid_relative_origin = {
+    (double)origin.x - grid_origin.x,
+    (double)origin.y - grid_origin.y
+  };
+
+  // The first edge crossed on each axis is the tile edge in ray direction. An axis
+  // parallel to the ray is never crossed, so its impact time stays infinite and
+  // does not change over any amount of steps
+  const SVec2i raycast_direction = helper_vector_direction(vector);
+  const SVec2d tile_edge_in_ray_direction = {
+    (double)(raycast_direction.x > 0 ? tile.x + 1 : tile.x) * tile_dimensions.x,
+    (double)(raycast_direction.y > 0 ? tile.y + 1 : tile.y) * tile_dimensions.y
+  };
+
+  p_traversal->origin = origin;
+  p_traversal->vector = vector;
+  p_traversal->tiles_on_axis = p_grid->tiles_on_axis;
+  p_traversal->direction = raycast_direction;
+  p_traversal->current_tile = tile;
+  p_traversal->edges_crossed = (SVec2i) { 0, 0 };
+  p_traversal->intersect_times_initial = (SVec2f) {
+    raycast_direction.x != 0 ? (float)((tile_edge_in_ray_direction.x - raycast_grid_relative_origin.x) / vector.x) : INFINITY,
+    raycast_direction.y != 0 ? (float)((tile_edge_in_ray_direction.y - raycast_grid_relative_origin.y) / vector.y) : INFINITY
+  };
+  p_traversal->intersect_time_per_tile = (SVec2f) {
+    raycast_direction.x != 0 ? (float)(tile_dimensions.x / fabs(vector.x)) : 0.0f,
+    raycast_direction.y != 0 ? (float)(tile_dimensions.y / fabs(vector.y)) : 0.0f
+  };
+  p_traversal->edge_position_initial = (SVec2f) {
+    (float)(grid_origin.x + tile_edge_in_ray_direction.x),
+    (float)(grid_origin.y + tile_edge_in_ray_direction.y)
+  };
+  p_traversal->edge_position_per_tile = (SVec2f) {
+    (float)raycast_direction.x * tile_dimensions.x,
+    (float)raycast_direction.y * tile_dimensions.y
+  };
+}
+
+// Returns false when the ray origin is outside of the grid
+static inline bool raycast_traversal_begin
+(
+  SRaycastTraversal * p_traversal,
+  const SGrid * p_grid,
+  SVec2f origin,
+  SVec2f vector
+)
+{
+  // Set up in double precision and relative to the tile containing the origin, so
+  // neither the grid size nor the distance to the grid origin costs precision
+  const SVec2d raycast_tile_origin_exact = {
+    floor(((double)origin.x - p_grid->origin_bottom_left.x) / p_grid->tile_dimensions.x),
+    floor(((double)origin.y - p_grid->origin_bottom_left.y) / p_grid->tile_dimensions.y)
+  };
+
+  // Consider raycast only when ray origin inside the grid
+  const bool origin_out_of_bounds =
+    !(raycast_tile_origin_exact.x >= 0.0 && raycast_tile_origin_exact.x < p_grid->tiles_on_axis.x) ||
+    !(raycast_tile_origin_exact.y >= 0.0 && raycast_tile_origin_exact.y < p_grid->tiles_on_axis.y);
+  if (origin_out_of_bounds) return false;
+
+  const SVec2i raycast_tile_origin = { (int)raycast_tile_origin_exact.x, (int)raycast_tile_origin_exact.y };
+  raycast_traversal_begin_in_tile(p_traversal, p_grid, origin, vector, raycast_tile_origin);
+
+  return true;
+}
+
+// Tiles only ever move in ray direction from an origin inside the grid, so only the
+// far side of the grid on each axis the ray moves along can be left
+static inline bool raycast_traversal_tile_past_grid(SVec2i tiles_on_axis, SVec2i tile, SVec2i direction)
+{
+  return
+    (direction.x > 0 ? tile.x >= tiles_on_axis.x : direction.x < 0 && tile.x < 0) ||
+    (direction.y > 0 ? tile.y >= tiles_on_axis.y : direction.y < 0 && tile.y < 0);
+}
+
+// Crosses the next edge and describes the entered tile, but for its exact exit
+// time. Returns false once the ray ends or leaves the grid. The direction must be the traversal direction and
+// is meant to be a constant, so the loops the step is inlined into are specialized
+// for one ray direction with every sign test and parallel axis folded away
+static inline __attribute__((always_inline)) bool raycast_traversal_step_toward
+(
+  SRaycastTraversal * p_traversal,
+  SImpactInformation * p_impact,
+  SVec2i direction
+)
+{
+  // Step both axis in lockstep, always crossing the edge with the smaller impact time
+  // first, so impacts are produced in ascending time without any sorting
+  //
+  // Do not accumulate the impact times but rather multiply by the edges crossed on
+  // each axis to avoid rounding errors over large raycast distances
+  const SVec2f next_impact_times = {
+    p_traversal->intersect_times_initial.x + p_traversal->intersect_time_per_tile.x * p_traversal->edges_crossed.x,
+    p_traversal->intersect_times_initial.y + p_traversal->intersect_time_per_tile.y * p_traversal->edges_crossed.y
+  };
+
+  // Ties step the vertical edge first, which reports both tiles around a corner hit.
+  // An axis parallel to the ray is never crossed
+  const bool crosses_vertical_edge = direction.x != 0 && (direction.y == 0 || next_impact_times.x <= next_impact_times.y);
+  const float impact_time = crosses_vertical_edge ? next_impact_times.x : next_impact_times.y;
+
+  // Stop stepping when the impact is further than the ray can reach
+  if (!(impact_time <= 1.0f)) return false;
+
+  // Snap the crossed axis onto the exact edge, the other one follows the ray. Both
+  // only move once the entered tile is known to be inside the grid, so a traversal
+  // that stopped still stands on its last tile
+  SVec2i entered_tile = p_traversal->current_tile;
+  SVec2f impact_point;
+  SVec2i impact_normal;
+  if (crosses_vertical_edge)
+  {
+    entered_tile.x += direction.x;
+    impact_point = (SVec2f) {
+      p_traversal->edge_position_initial.x + p_traversal->edge_position_per_tile.x * p_traversal->edges_crossed.x,
+      p_traversal->origin.y + p_traversal->vector.y * impact_time
+    };
+    impact_normal = (SVec2i) { -direction.x, 0 };
+  }
+  else
+  {
+    entered_tile.y += direction.y;
+    impact_point = (SVec2f) {
+      p_traversal->origin.x + p_traversal->vector.x * impact_time,
+      p_traversal->edge_position_initial.y + p_traversal->edge_position_per_tile.y * p_traversal->edges_crossed.y
+    };
+    impact_normal = (SVec2i) { 0, -direction.y };
+  }
+
+  // Stop stepping when the ray leaves the grid
+  if (raycast_traversal_tile_past_grid(p_traversal->tiles_on_axis, entered_tile, direction)) return false;
+
+  p_traversal->current_tile = entered_tile;
+  if (crosses_vertical_edge) p_traversal->edges_crossed.x++; else p_traversal->edges_crossed.y++;
+
+  // The exit time is only bounded by the end of the ray, see raycast_traversal_exit_time()
+  *p_impact = (SImpactInformation) { impact_time, impact_point, entered_tile, impact_normal, 1.0f };
+  return true;
+}
+
+// Time the ray leaves the current tile, at most at the end of the ray. Steps leave
+// the exit time of the entered tile to their caller, as it is the impact time of
+// the next step anyway, and only a hit or the last tile of a ray has to ask for it
+static inline float raycast_traversal_exit_time(const SRaycastTraversal * p_traversal)
+{
+  const SVec2f next_impact_times = {
+    p_traversal->intersect_times_initial.x + p_traversal->intersect_time_per_tile.x * p_traversal->edges_crossed.x,
+    p_traversal->intersect_times_initial.y + p_traversal->intersect_time_per_tile.y * p_traversal->edges_crossed.y
+  };
+  const float exit_time = next_impact_times.x <= next_impact_times.y ? next_impact_times.x : next_impact_times.y;
+
+  return exit_time <= 1.0f ? exit_time : 1.0f;
+}
+
+// Describes the origin tile as entered at time zero, for rays that stop right there
+static inline SImpactInformation raycast_traversal_origin_impact(const SRaycastTraversal * p_traversal)
+{
+  return (SImpactInformation) {
+    0.0f, p_traversal->origin, p_traversal->current_tile, { 0, 0 }, raycast_traversal_exit_time(p_traversal)
+  };
+}
+
+// Step for any ray direction
+static inline bool raycast_traversal_step(SRaycastTraversal * p_traversal, SImpactInformation * p_impact)
+{
+  return raycast_traversal_step_toward(p_traversal, p_impact, p_traversal->direction);
+}
+
+static inline bool raycast_traversal_edge_crossed_by
+(
+  float intersect_times_initial,
+  float intersect_time_per_tile,
+  int edge_index,
+  float time,
+  bool including_time
+)
+{
+  const float edge_time = intersect_times_initial + intersect_time_per_tile * edge_index;
+  return including_time ? edge_time <= time : edge_time < time;
+}
+
+// Number of edges on one axis the ray crosses before the given time, or up to and
+// including it. Estimated with a division and then settled on the exact impact
+// time expression of the stepping, so skipping and stepping never disagree
+static inline int raycast_traversal_edges_crossed_by
+(
+  float intersect_times_initial,
+  float intersect_time_per_tile,
+  float time,
+  bool including_time
+)
+{
+  // An axis parallel to the ray is never crossed
+  if (intersect_time_per_tile == 0.0f) return 0;
+
+  const float estimated_edges = ceilf((time - intersect_times_initial) / intersect_time_per_tile);
+  int edges = estimated_edges > 0.0f ? (int)estimated_edges : 0;
+
+  while (edges > 0 && !raycast_traversal_edge_crossed_by(intersect_times_initial, intersect_time_per_tile, edges - 1, time, including_time))
+  {
+    edges--;
+  }
+  while (raycast_traversal_edge_crossed_by(intersect_times_initial, intersect_time_per_tile, edges, time, including_time)) edges++;
+
+  return edges;
+}
+
+// Moves the traversal onto the last tile the ray enters within the aligned block of
+// 1 << block_shift tiles around the current tile, as if every tile in between was
+// stepped through. The next step leaves the block. Returns false when the ray ends
+// before it leaves the block. The direction is the traversal direction, see
+// raycast_traversal_step_toward()
+static inline __attribute__((always_inline)) bool raycast_traversal_skip_block_toward
+(
+  SRaycastTraversal * p_traversal,
+  int block_shift,
+  SVec2i direction
+)
+{
+  const SVec2i origin_tile = {
+    p_traversal->current_tile.x - direction.x * p_traversal->edges_crossed.x,
+    p_traversal->current_tile.y - direction.y * p_traversal->edges_crossed.y
+  };
+  const SVec2i block = { p_traversal->current_tile.x >> block_shift, p_traversal->current_tile.y >> block_shift };
+
+  // Index of the edge on each axis whose crossing enters the first tile past the block
+  const SVec2i exit_edge = {
+    ((direction.x > 0 ? (block.x + 1) << block_shift : (block.x << block_shift) - 1) - origin_tile.x) * direction.x - 1,
+    ((direction.y > 0 ? (block.y + 1) << block_shift : (block.y << block_shift) - 1) - origin_tile.y) * direction.y - 1
+  };
+  const SVec2f exit_times = {
+    direction.x != 0 ? p_traversal->intersect_times_initial.x + p_traversal->intersect_time_per_tile.x * exit_edge.x : INFINITY,
+    direction.y != 0 ? p_traversal->intersect_times_initial.y + p_traversal->intersect_time_per_tile.y * exit_edge.y : INFINITY
+  };
+
+  // Same tie rule as the stepping, the vertical edge goes first
+  const bool exits_vertical_edge = direction.x != 0 && (direction.y == 0 || exit_times.x <= exit_times.y);
+  const float exit_time = exits_vertical_edge ? exit_times.x : exit_times.y;
+  if (!(exit_time <= 1.0f)) return false;
+
+  const SVec2f intersect_times_initial = p_traversal->intersect_times_initial;
+  const SVec2f intersect_time_per_tile = p_traversal->intersect_time_per_tile;
+  if (exits_vertical_edge)
+  {
+    p_traversal->edges_crossed = (SVec2i) {
+      exit_edge.x,
+      direction.y != 0 ? raycast_traversal_edges_crossed_by(intersect_times_initial.y, intersect_time_per_tile.y, exit_time, false) : 0
+    };
+  }
+  else
+  {
+    p_traversal->edges_crossed = (SVec2i) {
+      direction.x != 0 ? raycast_traversal_edges_crossed_by(intersect_times_initial.x, intersect_time_per_tile.x, exit_time, true) : 0,
+      exit_edge.y
+    };
+  }
+
+  p_traversal->current_tile = (SVec2i) {
+    origin_tile.x + direction.x * p_traversal->edges_crossed.x,
+    origin_tile.y + direction.y * p_traversal->edges_crossed.y
+  };
+  return true;
+}
+
+// Block skip for any ray direction
+static inline bool raycast_traversal_skip_block(SRaycastTraversal * p_traversal, int block_shift)
+{
+  return raycast_traversal_skip_block_toward(p_traversal, block_shift, p_traversal->direction);
+}
+
+// Returns the kernel call specialized for the direction of the traversal. The
+// kernel takes the constant direction as its last argument, so every one of the
+// nine ray directions gets its own copy of an always inlined kernel
+#define RAYCAST_TRAVERSAL_DISPATCH_DIRECTION(p_traversal, kernel, ...) \
+  switch (((p_traversal)->direction.y + 1) * 3 + (p_traversal)->direction.x + 1) \
+  { \
+    case 0: return kernel(__VA_ARGS__, ((SVec2i) { -1, -1 })); \
+    case 1: return kernel(__VA_ARGS__, ((SVec2i) {  0, -1 })); \
+    case 2: return kernel(__VA_ARGS__, ((SVec2i) {  1, -1 })); \
+    case 3: return kernel(__VA_ARGS__, ((SVec2i) { -1,  0 })); \
+    case 4: return kernel(__VA_ARGS__, ((SVec2i) {  0,  0 })); \
+    case 5: return kernel(__VA_ARGS__, ((SVec2i) {  1,  0 })); \
+    case 6: return kernel(__VA_ARGS__, ((SVec2i) { -1,  1 })); \
+    case 7: return kernel(__VA_ARGS__, ((SVec2i) {  0,  1 })); \
+    default: return kernel(__VA_ARGS__, ((SVec2i) {  1,  1 })); \
+  }
+
+#endif
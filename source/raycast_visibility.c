@@ -0,0 +1,251 @@
+#include "raycast_visibility.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// One octant of the shadowcasting. Rows are scanned along the primary axis u away
+// from the origin, tiles within a row along the secondary axis v away from the
+// origin, and the octant covers the slopes v / u from zero to one. Coordinates are
+// relative to the origin in pixels
+typedef struct
+{
+  const STileOccupancy * p_occupancy;
+  SVisibilityMap * p_map;
+  SVec2i origin_tile;
+  SVec2d origin;
+  SVec2i tile_dimensions;
+  SVec2i tiles_on_axis;
+  double radius;
+  bool primary_axis_x;
+  int direction_u;
+  int direction_v;
+} SShadowcastOctant;
+
+typedef struct
+{
+  double min;
+  double max;
+} SSpan;
+
+// Slopes still to scan from a row on. Solid tiles leave the slopes before them to
+// a scan of their own, kept on a stack rather than recursing, so the depth does not
+// grow with the rows in view
+typedef struct
+{
+  int row;
+  double start_slope;
+  double end_slope;
+} SShadowcastScan;
+
+// Scans pending in all octants, on the stack of the caller until these run out
+#define SHADOWCAST_LOCAL_SCANS 64
+
+typedef struct
+{
+  SShadowcastScan * p_scans;
+  int capacity;
+  int count;
+  SShadowcastScan local_scans[SHADOWCAST_LOCAL_SCANS];
+} SShadowcastStack;
+
+bool visibility_map_create(SVisibilityMap * p_map, SVec2i tiles_on_axis)
+{
+  const int words_per_row = (tiles_on_axis.x + 63) / 64;
+  const size_t word_count = (size_t)words_per_row * tiles_on_axis.y;
+
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  *p_map = (SVisibilityMap) { tiles_on_axis, words_per_row, calloc(word_count > 0 ? word_count : 1, sizeof(uint64_t)) };
+  return p_map->p_words != NULL;
+}
+
+void visibility_map_destroy(SVisibilityMap * p_map)
+{
+  free(p_map->p_words);
+  *p_map = (SVisibilityMap) { { 0, 0 }, 0, NULL };
+}
+
+void visibility_map_clear(SVisibilityMap * p_map)
+{
+  memset(p_map->p_words, 0, sizeof(uint64_t) * p_map->words_per_row * p_map->tiles_on_axis.y);
+}
+
+// Only ever called with tiles of the grid, which the map matches
+static void visibility_map_mark(SVisibilityMap * p_map, SVec2i tile)
+{
+  p_map->p_words[(size_t)tile.y * p_map->words_per_row + (tile.x >> 6)] |= (uint64_t)1 << (tile.x & 63);
+}
+
+// Extent of a tile along one octant axis, relative to the origin and in octant direction
+static SSpan tile_span(double origin, int tile, int tile_size, int direction)
+{
+  const double min = (double)tile * tile_size - origin;
+  return direction > 0 ? (SSpan) { min, min + tile_size } : (SSpan) { -(min + tile_size), -min };
+}
+
+static bool push_scan(SShadowcastStack * p_stack, SShadowcastScan scan)
+{
+  if (p_stack->count == p_stack->capacity)
+  {
+    const int capacity = p_stack->capacity * 2;
+    SShadowcastScan * const p_scans = p_stack->p_scans == p_stack->local_scans
+      ? malloc(sizeof(SShadowcastScan) * capacity)
+      : realloc(p_stack->p_scans, sizeof(SShadowcastScan) * capacity);
+    PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+    if (p_scans == NULL) return false;
+
+    if (p_stack->p_scans == p_stack->local_scans) memcpy(p_scans, p_stack->local_scans, sizeof(p_stack->local_scans));
+    p_stack->p_scans = p_scans;
+    p_stack->capacity = capacity;
+  }
+
+  p_stack->p_scans[p_stack->count++] = scan;
+  return true;
+}
+
+// Scans rows from the given one on. Returns false when the slopes before a solid
+// tile could not be pushed for a scan of their own
+static bool shadowcast_octant(const SShadowcastOctant * p_octant, SShadowcastStack * p_stack, int row, double start_slope, double end_slope)
+{
+  const int origin_tile_u = p_octant->primary_axis_x ? p_octant->origin_tile.x : p_octant->origin_tile.y;
+  const int origin_tile_v = p_octant->primary_axis_x ? p_octant->origin_tile.y : p_octant->origin_tile.x;
+  const double origin_u = p_octant->primary_axis_x ? p_octant->origin.x : p_octant->origin.y;
+  const double origin_v = p_octant->primary_axis_x ? p_octant->origin.y : p_octant->origin.x;
+  const int tile_size_u = p_octant->primary_axis_x ? p_octant->tile_dimensions.x : p_octant->tile_dimensions.y;
+  const int tile_size_v = p_octant->primary_axis_x ? p_octant->tile_dimensions.y : p_octant->tile_dimensions.x;
+  const int tiles_on_axis_u = p_octant->primary_axis_x ? p_octant->tiles_on_axis.x : p_octant->tiles_on_axis.y;
+  const int tiles_on_axis_v = p_octant->primary_axis_x ? p_octant->tiles_on_axis.y : p_octant->tiles_on_axis.x;
+  const SSpan first_span_v = tile_span(origin_v, origin_tile_v, tile_size_v, p_octant->direction_v);
+
+  // Rows without a solid tile hand their slopes on to the next row in this loop,
+  // only the slopes left of a solid tile are pushed for a scan of their own
+  for (; start_slope < end_slope; row++)
+  {
+    const int tile_u = origin_tile_u + p_octant->direction_u * row;
+    if (tile_u < 0 || tile_u >= tiles_on_axis_u) return true;
+
+    // Only the part of the origin row ahead of the origin belongs to the octant. A
+    // row starting right at the origin starts at positive zero, so the slopes of
+    // its tiles reach up to positive infinity
+    SSpan span_u = tile_span(origin_u, tile_u, tile_size_u, p_octant->direction_u);
+    if (span_u.min > p_octant->radius) return true;
+    if (span_u.min <= 0.0) span_u.min = 0.0;
+    if (span_u.max <= 0.0) continue;
+
+    // First tile of the row that can reach the start slope
+    const double first_tile_estimate = floor((start_slope * span_u.min - first_span_v.min) / tile_size_v) - 1.0;
+    const int first_tile_offset = first_tile_estimate > 0.0 ? (int)first_tile_estimate : 0;
+
+    bool blocked = false;
+    double next_start_slope = start_slope;
+    for (int tile_offset = first_tile_offset; ; tile_offset++)
+    {
+      const int tile_v = origin_tile_v + p_octant->direction_v * tile_offset;
+      if (tile_v < 0 || tile_v >= tiles_on_axis_v) break;
+
+      // Slopes of the rays through the tile, the origin row tiles reach up to infinity
+      const SSpan span_v = { first_span_v.min + (double)tile_offset * tile_size_v, first_span_v.min + (double)(tile_offset + 1) * tile_size_v };
+      const double low_slope = span_v.min >= 0.0 ? span_v.min / span_u.max : span_v.min / span_u.min;
+      const double high_slope = span_v.max > 0.0 ? span_v.max / span_u.min : span_v.max / span_u.max;
+
+      if (high_slope <= start_slope) continue;
+      if (low_slope >= end_slope) break;
+
+      const SVec2i tile = p_octant->primary_axis_x ? (SVec2i) { tile_u, tile_v } : (SVec2i) { tile_v, tile_u };
+      const double nearest_v = span_v.min > 0.0 ? span_v.min : (span_v.max < 0.0 ? -span_v.max : 0.0);
+      if (span_u.min * span_u.min + nearest_v * nearest_v <= p_octant->radius * p_octant->radius)
+      {
+        visibility_map_mark(p_octant->p_map, tile);
+      }
+
+      // The origin tile never blocks, the view starts inside of it
+      const bool solid = (row != 0 || tile_offset != 0) && tile_occupancy_solid(p_octant->p_occupancy, tile);
+      if (blocked)
+      {
+        if (solid)
+        {
+          next_start_slope = high_slope;
+        }
+        else
+        {
+          blocked = false;
+          start_slope = next_start_slope;
+        }
+      }
+      else if (solid)
+      {
+        if (!push_scan(p_stack, (SShadowcastScan) { row + 1, start_slope, low_slope })) return false;
+        blocked = true;
+        next_start_slope = high_slope;
+      }
+    }
+
+    if (blocked) return true;
+  }
+
+  return true;
+}
+
+ERaycastResultType raycast_visibility
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  float radius,
+  SVisibilityMap * p_out_map
+)
+{
+  const bool sizes_match =
+    tile_occupancy_matches_grid(p_occupancy, p_grid) &&
+    p_out_map->tiles_on_axis.x == p_grid->tiles_on_axis.x && p_out_map->tiles_on_axis.y == p_grid->tiles_on_axis.y;
+  if (!sizes_match) return RAYCAST_OCCUPANCY_MISMATCH;
+
+  const SVec2d raycast_grid_relative_origin = {
+    (double)origin.x - p_grid->origin_bottom_left.x,
+    (double)origin.y - p_grid->origin_bottom_left.y
+  };
+  const SVec2d raycast_tile_origin_exact = {
+    floor(raycast_grid_relative_origin.x / p_grid->tile_dimensions.x),
+    floor(raycast_grid_relative_origin.y / p_grid->tile_dimensions.y)
+  };
+
+  // Consider visibility only when the origin is inside the grid
+  const bool origin_out_of_bounds =
+    !(raycast_tile_origin_exact.x >= 0.0 && raycast_tile_origin_exact.x < p_grid->tiles_on_axis.x) ||
+    !(raycast_tile_origin_exact.y >= 0.0 && raycast_tile_origin_exact.y < p_grid->tiles_on_axis.y);
+  if (origin_out_of_bounds) return RAYCAST_ORIGIN_OUT_OF_BOUNDS;
+
+  const SVec2i origin_tile = { (int)raycast_tile_origin_exact.x, (int)raycast_tile_origin_exact.y };
+  visibility_map_mark(p_out_map, origin_tile);
+
+  SShadowcastStack stack;
+  stack.p_scans = stack.local_scans;
+  stack.capacity = SHADOWCAST_LOCAL_SCANS;
+  stack.count = 0;
+
+  bool scanned = true;
+  for (int octant = 0; octant < 8 && scanned; octant++)
+  {
+    const SShadowcastOctant shadowcast = {
+      p_occupancy,
+      p_out_map,
+      origin_tile,
+      raycast_grid_relative_origin,
+      p_grid->tile_dimensions,
+      p_grid->tiles_on_axis,
+      radius,
+      (octant & 4) == 0,
+      octant & 1 ? -1 : 1,
+      octant & 2 ? -1 : 1
+    };
+    scanned = shadowcast_octant(&shadowcast, &stack, 0, 0.0, 1.0);
+    while (scanned && stack.count > 0)
+    {
+      const SShadowcastScan scan = stack.p_scans[--stack.count];
+      scanned = shadowcast_octant(&shadowcast, &stack, scan.row, scan.start_slope, scan.end_slope);
+    }
+  }
+
+  if (stack.p_scans != stack.local_scans) free(stack.p_scans);
+  return scanned ? RAYCAST_SUCCESS : RAYCAST_BUFFER_EXHAUSTED;
+}
@@ -0,0 +1,52 @@
+#ifndef RAYCAST_VISIBILITY_H
+#define RAYCAST_VISIBILITY_H
+
+#include "raycast.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// One visible flag per grid tile, 64 tiles of a row per word
+typedef struct
+{
+  SVec2i tiles_on_axis;
+  int words_per_row;
+  uint64_t * p_words;
+} SVisibilityMap;
+
+// All tiles start out not visible
+bool visibility_map_create(SVisibilityMap * p_map, SVec2i tiles_on_axis);
+void visibility_map_destroy(SVisibilityMap * p_map);
+void visibility_map_clear(SVisibilityMap * p_map);
+
+// Tiles outside of the map are not visible
+static inline bool visibility_map_visible(const SVisibilityMap * p_map, SVec2i tile)
+{
+  if (tile.x < 0 || tile.x >= p_map->tiles_on_axis.x || tile.y < 0 || tile.y >= p_map->tiles_on_axis.y) return false;
+
+  const uint64_t word = p_map->p_words[(size_t)tile.y * p_map->words_per_row + (tile.x >> 6)];
+  return (word >> (tile.x & 63)) & 1;
+}
+
+// Marks every tile visible from the origin within the radius in pixels, solid
+// tiles included, so walls bounding the view are visible too. Tiles are only ever
+// marked, so casts from several origins accumulate into one map, for example to
+// keep explored tiles of a fog of war. The map and the occupancy must have the
+// tiles on each axis the grid has, else nothing is marked and
+// RAYCAST_OCCUPANCY_MISMATCH is returned. Returns RAYCAST_BUFFER_EXHAUSTED when the
+// memory for the pending scans runs out, leaving the view partly marked.
+//
+// Shadowcasting in eight octants around the origin. Rows of tiles are scanned
+// outward and every solid tile narrows the still visible slopes for all rows behind
+// it, so each tile in view is visited once instead of once per ray of a ray fan
+// through it. A tile is visible when any ray from the origin with a still visible
+// slope passes through it within the radius
+ERaycastResultType raycast_visibility
+(
+  const SGrid * p_grid,
+  const STileOccupancy * p_occupancy,
+  SVec2f origin,
+  float radius,
+  SVisibilityMap * p_out_map
+);
+
+#endif
@@ -0,0 +1,125 @@
+// Vertex buffer objects are core since OpenGL 1.5, the headers only declare them
+// with the extension prototypes enabled
+#define GL_GLEXT_PROTOTYPES
+
+#include "render_batch.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <stddef.h>
+
+#define RENDER_BATCH_INITIAL_CAPACITY 1024
+
+static uint8_t color_channel(float channel)
+{
+  if (!(channel > 0.0f)) return 0;
+  if (channel >= 1.0f) return 255;
+  return (uint8_t)(channel * 255.0f + 0.5f);
+}
+
+// Makes room for the vertices of one more primitive. Returns false when out of memory
+static bool reserve_vertices(SRenderBatch * p_batch, int vertex_count)
+{
+  if (p_batch->count + vertex_count <= p_batch->capacity) return true;
+
+  int capacity = p_batch->capacity > 0 ? p_batch->capacity : RENDER_BATCH_INITIAL_CAPACITY;
+  while (capacity < p_batch->count + vertex_count) capacity *= 2;
+
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  SRenderVertex * const p_vertices = realloc(p_batch->p_vertices, sizeof(SRenderVertex) * capacity);
+  if (p_vertices == NULL) return false;
+
+  p_batch->p_vertices = p_vertices;
+  p_batch->capacity = capacity;
+  return true;
+}
+
+static void push_vertex(SRenderBatch * p_batch, float x, float y, SRenderColor color)
+{
+  p_batch->p_vertices[p_batch->count++] = (SRenderVertex) {
+    x, y, color_channel(color.r), color_channel(color.g), color_channel(color.b), color_channel(color.a)
+  };
+}
+
+bool render_batch_create(SRenderBatch * p_batch, GLenum primitive, GLenum usage)
+{
+  *p_batch = (SRenderBatch) { primitive, usage, 0, 0, NULL, 0, 0 };
+  glGenBuffers(1, &p_batch->vertex_buffer);
+
+  return p_batch->vertex_buffer != 0 && reserve_vertices(p_batch, RENDER_BATCH_INITIAL_CAPACITY);
+}
+
+void render_batch_destroy(SRenderBatch * p_batch)
+{
+  if (p_batch->vertex_buffer != 0) glDeleteBuffers(1, &p_batch->vertex_buffer);
+  free(p_batch->p_vertices);
+  *p_batch = (SRenderBatch) { p_batch->primitive, p_batch->usage, 0, 0, NULL, 0, 0 };
+}
+
+void render_batch_clear(SRenderBatch * p_batch)
+{
+  p_batch->count = 0;
+}
+
+void render_batch_point(SRenderBatch * p_batch, float x, float y, SRenderColor color)
+{
+  if (!reserve_vertices(p_batch, 1)) return;
+
+  push_vertex(p_batch, x, y, color);
+}
+
+void render_batch_line(SRenderBatch * p_batch, float from_x, float from_y, float to_x, float to_y, SRenderColor color)
+{
+  if (!reserve_vertices(p_batch, 2)) return;
+
+  push_vertex(p_batch, from_x, from_y, color);
+  push_vertex(p_batch, to_x, to_y, color);
+}
+
+void render_batch_rect(SRenderBatch * p_batch, float min_x, float min_y, float max_x, float max_y, SRenderColor color)
+{
+  if (!reserve_vertices(p_batch, 6)) return;
+
+  // Two triangles, as quads are not available as a vertex array primitive everywhere
+  push_vertex(p_batch, min_x, min_y, color);
+  push_vertex(p_batch, max_x, min_y, color);
+  push_vertex(p_batch, max_x, max_y, color);
+  push_vertex(p_batch, min_x, min_y, color);
+  push_vertex(p_batch, max_x, max_y, color);
+  push_vertex(p_batch, min_x, max_y, color);
+}
+
+void render_batch_upload(SRenderBatch * p_batch)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, p_batch->vertex_buffer);
+
+  // Reallocate the buffer storage only when it is outgrown, and then to the whole
+  // capacity of the batch, otherwise overwrite the vertices in place
+  if (p_batch->count > p_batch->uploaded_capacity)
+  {
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(sizeof(SRenderVertex) * p_batch->capacity), NULL, p_batch->usage);
+    p_batch->uploaded_capacity = p_batch->capacity;
+  }
+  if (p_batch->count > 0)
+  {
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(sizeof(SRenderVertex) * p_batch->count), p_batch->p_vertices);
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void render_batch_draw(const SRenderBatch * p_batch)
+{
+  if (p_batch->count == 0) return;
+
+  glBindBuffer(GL_ARRAY_BUFFER, p_batch->vertex_buffer);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  glVertexPointer(2, GL_FLOAT, sizeof(SRenderVertex), (const void *)offsetof(SRenderVertex, x));
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(SRenderVertex), (const void *)offsetof(SRenderVertex, r));
+
+  glDrawArrays(p_batch->primitive, 0, p_batch->count);
+
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
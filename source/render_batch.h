@@ -0,0 +1,59 @@
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#include <SDL2/SDL_opengl.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Position and color of one vertex, laid out for the fixed function vertex arrays
+typedef struct
+{
+  float x;
+  float y;
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t a;
+} SRenderVertex;
+
+typedef struct
+{
+  float r;
+  float g;
+  float b;
+  float a;
+} SRenderColor;
+
+// Primitives of one kind, collected on the CPU and drawn from a vertex buffer
+// object with a single draw call. The vertex buffer persists and is only
+// reallocated when the vertices outgrow it, so rebuilding a batch every frame
+// costs one buffer upload no matter how many primitives it holds
+typedef struct
+{
+  GLenum primitive;
+  GLenum usage;
+  GLuint vertex_buffer;
+  int uploaded_capacity;
+  SRenderVertex * p_vertices;
+  int capacity;
+  int count;
+} SRenderBatch;
+
+// Points, lines or triangles. Batches filled once, like the grid lines, pass
+// GL_STATIC_DRAW, batches rebuilt every frame GL_STREAM_DRAW
+bool render_batch_create(SRenderBatch * p_batch, GLenum primitive, GLenum usage);
+void render_batch_destroy(SRenderBatch * p_batch);
+void render_batch_clear(SRenderBatch * p_batch);
+
+// Primitives beyond the memory available are dropped
+void render_batch_point(SRenderBatch * p_batch, float x, float y, SRenderColor color);
+void render_batch_line(SRenderBatch * p_batch, float from_x, float from_y, float to_x, float to_y, SRenderColor color);
+void render_batch_rect(SRenderBatch * p_batch, float min_x, float min_y, float max_x, float max_y, SRenderColor color);
+
+// Hands the vertices to the vertex buffer, once after the batch was rebuilt
+void render_batch_upload(SRenderBatch * p_batch);
+
+// Draws whatever was uploaded last
+void render_batch_draw(const SRenderBatch * p_batch);
+
+#endif
@@ -0,0 +1,110 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "simulation_loop.h"
+#include <time.h>
+
+// Ticks the loop runs back to back to catch up before it skips ahead instead
+#define MAX_CATCH_UP_TICKS 4
+
+static uint64_t now_ns(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * UINT64_C(1000000000) + (uint64_t)time.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t wake_ns)
+{
+  const struct timespec wake_time = { (time_t)(wake_ns / UINT64_C(1000000000)), (long)(wake_ns % UINT64_C(1000000000)) };
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_time, NULL);
+}
+
+static void * simulation_main(void * p_argument)
+{
+  SSimulationLoop * const p_loop = p_argument;
+
+  uint64_t next_tick_ns = now_ns();
+  while (__atomic_load_n(&p_loop->running, __ATOMIC_ACQUIRE))
+  {
+    if (p_loop->step_ns > 0)
+    {
+      const uint64_t current_ns = now_ns();
+      if (current_ns < next_tick_ns)
+      {
+        // Check for a stop again after every sleep, which lasts one tick at most
+        sleep_until_ns(next_tick_ns);
+        continue;
+      }
+
+      const uint64_t ticks_behind = (current_ns - next_tick_ns) / p_loop->step_ns;
+      if (ticks_behind > MAX_CATCH_UP_TICKS)
+      {
+        __atomic_store_n(&p_loop->stats.dropped_ticks, p_loop->stats.dropped_ticks + ticks_behind, __ATOMIC_RELAXED);
+        next_tick_ns += ticks_behind * p_loop->step_ns;
+      }
+    }
+
+    const uint64_t step_start_ns = now_ns();
+    p_loop->step(p_loop->p_context, triple_buffer_write_slot(&p_loop->snapshots), p_loop->stats.ticks);
+    triple_buffer_publish(&p_loop->snapshots);
+
+    // Only this thread writes the stats, readers may see them a tick late
+    __atomic_store_n(&p_loop->stats.busy_ns, p_loop->stats.busy_ns + (now_ns() - step_start_ns), __ATOMIC_RELAXED);
+    __atomic_store_n(&p_loop->stats.ticks, p_loop->stats.ticks + 1, __ATOMIC_RELAXED);
+    next_tick_ns += p_loop->step_ns;
+  }
+
+  return NULL;
+}
+
+bool simulation_loop_start
+(
+  SSimulationLoop * p_loop,
+  size_t snapshot_size,
+  double step_seconds,
+  FSimulationStep step,
+  void * p_context
+)
+{
+  *p_loop = (SSimulationLoop) {
+    .step = step,
+    .p_context = p_context,
+    .step_ns = step_seconds > 0.0 ? (uint64_t)(step_seconds * 1e9 + 0.5) : 0,
+    .running = true
+  };
+  if (!triple_buffer_create(&p_loop->snapshots, snapshot_size)) return false;
+
+  if (pthread_create(&p_loop->thread, NULL, simulation_main, p_loop) != 0)
+  {
+    triple_buffer_destroy(&p_loop->snapshots);
+    return false;
+  }
+
+  return true;
+}
+
+void simulation_loop_stop(SSimulationLoop * p_loop)
+{
+  __atomic_store_n(&p_loop->running, false, __ATOMIC_RELEASE);
+  pthread_join(p_loop->thread, NULL);
+  triple_buffer_destroy(&p_loop->snapshots);
+}
+
+bool simulation_loop_acquire(SSimulationLoop * p_loop)
+{
+  return triple_buffer_acquire(&p_loop->snapshots);
+}
+
+const void * simulation_loop_snapshot(const SSimulationLoop * p_loop)
+{
+  return triple_buffer_read_slot(&p_loop->snapshots);
+}
+
+SSimulationStats simulation_loop_stats(const SSimulationLoop * p_loop)
+{
+  return (SSimulationStats) {
+    __atomic_load_n(&p_loop->stats.ticks, __ATOMIC_RELAXED),
+    __atomic_load_n(&p_loop->stats.dropped_ticks, __ATOMIC_RELAXED),
+    __atomic_load_n(&p_loop->stats.busy_ns, __ATOMIC_RELAXED)
+  };
+}
@@ -0,0 +1,61 @@
+#ifndef SIMULATION_LOOP_H
+#define SIMULATION_LOOP_H
+
+#include "triple_buffer.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Advances the simulation by one tick and writes everything the consumer needs
+// into the snapshot. The slot still holds whatever was written into it three
+// publishes ago, so every field the consumer reads has to be written again
+typedef void (*FSimulationStep)(void * p_context, void * p_snapshot, uint64_t tick);
+
+typedef struct
+{
+  uint64_t ticks;
+  // Ticks given up on because the steps fell too far behind the schedule
+  uint64_t dropped_ticks;
+  // Time spent inside the step callback
+  uint64_t busy_ns;
+} SSimulationStats;
+
+// Runs a fixed timestep simulation on a thread of its own and hands every tick's
+// snapshot to the consumer through a triple buffer, so neither side ever waits
+// for the other. Ticks follow a fixed schedule, a step running late is caught up
+// back to back, and more than a few ticks behind the schedule moves on instead.
+// The loop must not move between start and stop
+typedef struct
+{
+  pthread_t thread;
+  STripleBuffer snapshots;
+  FSimulationStep step;
+  void * p_context;
+  uint64_t step_ns;
+  bool running;
+  SSimulationStats stats;
+} SSimulationLoop;
+
+// A step time of zero runs the ticks back to back as fast as the step allows,
+// which measures the simulation on its own
+bool simulation_loop_start
+(
+  SSimulationLoop * p_loop,
+  size_t snapshot_size,
+  double step_seconds,
+  FSimulationStep step,
+  void * p_context
+);
+
+// Returns after the tick in progress has finished
+void simulation_loop_stop(SSimulationLoop * p_loop);
+
+// Consumer side - Moves to the latest snapshot. Returns false when no tick
+// finished since the last acquire, the snapshot stays the same then. Before the
+// first tick the snapshot is zeroed
+bool simulation_loop_acquire(SSimulationLoop * p_loop);
+const void * simulation_loop_snapshot(const SSimulationLoop * p_loop);
+
+SSimulationStats simulation_loop_stats(const SSimulationLoop * p_loop);
+
+#endif
@@ -0,0 +1,208 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "tile_chunk_store.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAP_FILE_MAGIC 0x4D435247u
+#define MAP_FILE_VERSION 1u
+
+#define BLOCKS_PER_CHUNK_ROW (TILE_CHUNK_SIZE >> TILE_CHUNK_BLOCK_SHIFT)
+#define BLOCK_ROW_MASK ((UINT64_C(1) << (1 << TILE_CHUNK_BLOCK_SHIFT)) - 1)
+
+// The chunks start on a 64 byte boundary behind the table, so a mapped file keeps
+// every chunk row aligned
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  SVec2i tiles_on_axis;
+  SVec2i chunks_on_axis;
+  uint32_t chunk_count;
+  uint32_t chunk_size;
+  uint64_t chunks_offset;
+  unsigned char reserved[24];
+} SMapFileHeader;
+
+static size_t chunk_table_entries(SVec2i chunks_on_axis)
+{
+  return (size_t)chunks_on_axis.x * chunks_on_axis.y;
+}
+
+static uint64_t chunks_offset(SVec2i chunks_on_axis)
+{
+  const uint64_t table_end = sizeof(SMapFileHeader) + sizeof(uint32_t) * (uint64_t)chunk_table_entries(chunks_on_axis);
+  return (table_end + 63) & ~(uint64_t)63;
+}
+
+static STileChunk * materialize_chunk(STileChunkStore * p_store, size_t table_index)
+{
+  if (p_store->chunk_count == p_store->chunk_capacity)
+  {
+    const uint32_t grown_capacity = p_store->chunk_capacity > 0 ? p_store->chunk_capacity * 2 : 16;
+    PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+    STileChunk * const p_grown_chunks = realloc(p_store->p_chunks, sizeof(STileChunk) * grown_capacity);
+    if (p_grown_chunks == NULL) return NULL;
+
+    p_store->p_chunks = p_grown_chunks;
+    p_store->chunk_capacity = grown_capacity;
+  }
+
+  STileChunk * const p_chunk = &p_store->p_chunks[p_store->chunk_count++];
+  memset(p_chunk, 0, sizeof(STileChunk));
+  p_store->p_chunk_table[table_index] = p_store->chunk_count;
+
+  return p_chunk;
+}
+
+bool tile_chunk_store_create(STileChunkStore * p_store, SVec2i tiles_on_axis)
+{
+  *p_store = (STileChunkStore) { 0 };
+  p_store->tiles_on_axis = tiles_on_axis;
+  p_store->chunks_on_axis = (SVec2i) {
+    (tiles_on_axis.x + TILE_CHUNK_SIZE - 1) >> TILE_CHUNK_SHIFT,
+    (tiles_on_axis.y + TILE_CHUNK_SIZE - 1) >> TILE_CHUNK_SHIFT
+  };
+
+  const size_t table_entries = chunk_table_entries(p_store->chunks_on_axis);
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  p_store->p_chunk_table = calloc(table_entries > 0 ? table_entries : 1, sizeof(uint32_t));
+
+  return p_store->p_chunk_table != NULL;
+}
+
+void tile_chunk_store_destroy(STileChunkStore * p_store)
+{
+  if (p_store->p_mapping != NULL)
+  {
+    munmap(p_store->p_mapping, p_store->mapping_size);
+  }
+  else
+  {
+    free(p_store->p_chunk_table);
+    free(p_store->p_chunks);
+  }
+
+  *p_store = (STileChunkStore) { 0 };
+}
+
+bool tile_chunk_store_set(STileChunkStore * p_store, SVec2i tile, bool solid)
+{
+  if (p_store->p_mapping != NULL) return false;
+  if (tile.x < 0 || tile.x >= p_store->tiles_on_axis.x || tile.y < 0 || tile.y >= p_store->tiles_on_axis.y) return true;
+
+  const size_t table_index = (size_t)(tile.y >> TILE_CHUNK_SHIFT) * p_store->chunks_on_axis.x + (tile.x >> TILE_CHUNK_SHIFT);
+  const uint32_t chunk_number = p_store->p_chunk_table[table_index];
+
+  // Emptying a tile of an empty chunk changes nothing, so only solid tiles materialize
+  if (chunk_number == 0 && !solid) return true;
+
+  STileChunk * const p_chunk = chunk_number != 0 ? &p_store->p_chunks[chunk_number - 1] : materialize_chunk(p_store, table_index);
+  if (p_chunk == NULL) return false;
+
+  const SVec2i tile_in_chunk = { tile.x & (TILE_CHUNK_SIZE - 1), tile.y & (TILE_CHUNK_SIZE - 1) };
+  const SVec2i block = { tile_in_chunk.x >> TILE_CHUNK_BLOCK_SHIFT, tile_in_chunk.y >> TILE_CHUNK_BLOCK_SHIFT };
+  const uint64_t block_bit = UINT64_C(1) << (block.y * BLOCKS_PER_CHUNK_ROW + block.x);
+
+  if (solid)
+  {
+    p_chunk->rows[tile_in_chunk.y] |= UINT64_C(1) << tile_in_chunk.x;
+    p_chunk->block_mask |= block_bit;
+    return true;
+  }
+
+  p_chunk->rows[tile_in_chunk.y] &= ~(UINT64_C(1) << tile_in_chunk.x);
+
+  // The block stays solid while any of its other tiles is. Emptied chunks stay
+  // materialized, their empty block mask already lets rays leap across them
+  const int first_block_row = block.y << TILE_CHUNK_BLOCK_SHIFT;
+  bool block_solid = false;
+  for (int row = first_block_row; row < first_block_row + (1 << TILE_CHUNK_BLOCK_SHIFT); row++)
+  {
+    block_solid |= ((p_chunk->rows[row] >> (block.x << TILE_CHUNK_BLOCK_SHIFT)) & BLOCK_ROW_MASK) != 0;
+  }
+
+  if (!block_solid) p_chunk->block_mask &= ~block_bit;
+  return true;
+}
+
+bool tile_chunk_store_save(const STileChunkStore * p_store, const char * p_path)
+{
+  FILE * const p_file = fopen(p_path, "wb");
+  if (p_file == NULL) return false;
+
+  const SMapFileHeader header = {
+    MAP_FILE_MAGIC,
+    MAP_FILE_VERSION,
+    p_store->tiles_on_axis,
+    p_store->chunks_on_axis,
+    p_store->chunk_count,
+    sizeof(STileChunk),
+    chunks_offset(p_store->chunks_on_axis),
+    { 0 }
+  };
+  const size_t table_entries = chunk_table_entries(p_store->chunks_on_axis);
+  const unsigned char padding[64] = { 0 };
+  const size_t padding_size = (size_t)(header.chunks_offset - sizeof(SMapFileHeader) - sizeof(uint32_t) * table_entries);
+
+  bool written =
+    fwrite(&header, sizeof(header), 1, p_file) == 1 &&
+    fwrite(p_store->p_chunk_table, sizeof(uint32_t), table_entries, p_file) == table_entries &&
+    fwrite(padding, 1, padding_size, p_file) == padding_size &&
+    fwrite(p_store->p_chunks, sizeof(STileChunk), p_store->chunk_count, p_file) == p_store->chunk_count;
+
+  written &= fclose(p_file) == 0;
+  return written;
+}
+
+bool tile_chunk_store_map(STileChunkStore * p_store, const char * p_path)
+{
+  *p_store = (STileChunkStore) { 0 };
+
+  const int file_descriptor = open(p_path, O_RDONLY);
+  if (file_descriptor < 0) return false;
+
+  struct stat file_status;
+  const bool has_size = fstat(file_descriptor, &file_status) == 0 && (size_t)file_status.st_size >= sizeof(SMapFileHeader);
+  void * const p_mapping = has_size ?
+    mmap(NULL, (size_t)file_status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0) : MAP_FAILED;
+
+  // The mapping stays valid after the descriptor is closed
+  close(file_descriptor);
+  if (p_mapping == MAP_FAILED) return false;
+
+  const size_t mapping_size = (size_t)file_status.st_size;
+  const SMapFileHeader * const p_header = p_mapping;
+  const bool valid_header =
+    p_header->magic == MAP_FILE_MAGIC &&
+    p_header->version == MAP_FILE_VERSION &&
+    p_header->chunk_size == sizeof(STileChunk) &&
+    p_header->tiles_on_axis.x >= 0 && p_header->tiles_on_axis.y >= 0 &&
+    p_header->chunks_on_axis.x == (p_header->tiles_on_axis.x + TILE_CHUNK_SIZE - 1) >> TILE_CHUNK_SHIFT &&
+    p_header->chunks_on_axis.y == (p_header->tiles_on_axis.y + TILE_CHUNK_SIZE - 1) >> TILE_CHUNK_SHIFT &&
+    p_header->chunks_offset == chunks_offset(p_header->chunks_on_axis) &&
+    p_header->chunks_offset + sizeof(STileChunk) * (uint64_t)p_header->chunk_count <= mapping_size;
+
+  if (!valid_header)
+  {
+    munmap(p_mapping, mapping_size);
+    return false;
+  }
+
+  p_store->tiles_on_axis = p_header->tiles_on_axis;
+  p_store->chunks_on_axis = p_header->chunks_on_axis;
+  p_store->chunk_count = p_header->chunk_count;
+  p_store->chunk_capacity = p_header->chunk_count;
+  p_store->p_chunk_table = (uint32_t *)((unsigned char *)p_mapping + sizeof(SMapFileHeader));
+  p_store->p_chunks = (STileChunk *)((unsigned char *)p_mapping + p_header->chunks_offset);
+  p_store->p_mapping = p_mapping;
+  p_store->mapping_size = mapping_size;
+
+  return true;
+}
@@ -0,0 +1,94 @@
+#ifndef TILE_CHUNK_STORE_H
+#define TILE_CHUNK_STORE_H
+
+#include "datatypes.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Chunks are 64x64 tiles, one word per tile row
+#define TILE_CHUNK_SHIFT 6
+#define TILE_CHUNK_SIZE (1 << TILE_CHUNK_SHIFT)
+
+// 8x8 tile blocks inside a chunk, one bit per block in the chunk block mask
+#define TILE_CHUNK_BLOCK_SHIFT 3
+
+typedef struct
+{
+  uint64_t block_mask;
+  uint64_t rows[TILE_CHUNK_SIZE];
+} STileChunk;
+
+// Sparse solid tiles in 64x64 tile chunks. Chunks without a solid tile are not
+// materialized and take up only their chunk table entry, so a store is either
+// built in memory or maps a map file straight into memory without copying.
+// Mapped stores are read only
+typedef struct
+{
+  SVec2i tiles_on_axis;
+  SVec2i chunks_on_axis;
+  uint32_t chunk_count;
+  uint32_t chunk_capacity;
+  uint32_t * p_chunk_table;
+  STileChunk * p_chunks;
+  void * p_mapping;
+  size_t mapping_size;
+} STileChunkStore;
+
+// All tiles start out empty
+bool tile_chunk_store_create(STileChunkStore * p_store, SVec2i tiles_on_axis);
+void tile_chunk_store_destroy(STileChunkStore * p_store);
+
+// Returns false for mapped stores and when a new chunk cannot be allocated.
+// Tiles outside of the store are ignored
+bool tile_chunk_store_set(STileChunkStore * p_store, SVec2i tile, bool solid);
+
+// Map file layout, in native byte order - A header, the chunk table with one entry
+// per chunk row by row, zero for empty chunks and the one based chunk index
+// otherwise, and then all materialized chunks
+bool tile_chunk_store_save(const STileChunkStore * p_store, const char * p_path);
+
+// Maps a map file read only. Only the header is parsed, the tiles are paged in by
+// the operating system as rays touch them
+bool tile_chunk_store_map(STileChunkStore * p_store, const char * p_path);
+
+// Whether the store holds the tiles of the grid, queries against any other grid
+// would report tiles the store does not have
+static inline bool tile_chunk_store_matches_grid(const STileChunkStore * p_store, const SGrid * p_grid)
+{
+  return p_store->tiles_on_axis.x == p_grid->tiles_on_axis.x && p_store->tiles_on_axis.y == p_grid->tiles_on_axis.y;
+}
+
+// NULL for empty chunks and chunks outside of the store
+static inline const STileChunk * tile_chunk_store_chunk(const STileChunkStore * p_store, SVec2i chunk)
+{
+  if (chunk.x < 0 || chunk.x >= p_store->chunks_on_axis.x || chunk.y < 0 || chunk.y >= p_store->chunks_on_axis.y) return NULL;
+
+  // Entries past the chunk count only come from damaged map files, read them as empty
+  const uint32_t chunk_number = p_store->p_chunk_table[(size_t)chunk.y * p_store->chunks_on_axis.x + chunk.x];
+  return chunk_number != 0 && chunk_number <= p_store->chunk_count ? &p_store->p_chunks[chunk_number - 1] : NULL;
+}
+
+// Tiles outside of the store are empty
+static inline bool tile_chunk_store_solid(const STileChunkStore * p_store, SVec2i tile)
+{
+  if (tile.x < 0 || tile.x >= p_store->tiles_on_axis.x || tile.y < 0 || tile.y >= p_store->tiles_on_axis.y) return false;
+
+  const STileChunk * const p_chunk = tile_chunk_store_chunk(p_store, (SVec2i) { tile.x >> TILE_CHUNK_SHIFT, tile.y >> TILE_CHUNK_SHIFT });
+  return p_chunk != NULL && ((p_chunk->rows[tile.y & (TILE_CHUNK_SIZE - 1)] >> (tile.x & (TILE_CHUNK_SIZE - 1))) & 1);
+}
+
+// Tile shift of the largest empty block around a tile inside the store, zero when
+// even its 8x8 block holds a solid tile
+static inline int tile_chunk_store_empty_block_shift(const STileChunkStore * p_store, SVec2i tile)
+{
+  const STileChunk * const p_chunk = tile_chunk_store_chunk(p_store, (SVec2i) { tile.x >> TILE_CHUNK_SHIFT, tile.y >> TILE_CHUNK_SHIFT });
+  if (p_chunk == NULL) return TILE_CHUNK_SHIFT;
+
+  const int block_index =
+    ((tile.y & (TILE_CHUNK_SIZE - 1)) >> TILE_CHUNK_BLOCK_SHIFT) * (TILE_CHUNK_SIZE >> TILE_CHUNK_BLOCK_SHIFT) +
+    ((tile.x & (TILE_CHUNK_SIZE - 1)) >> TILE_CHUNK_BLOCK_SHIFT);
+  return (p_chunk->block_mask >> block_index) & 1 ? 0 : TILE_CHUNK_BLOCK_SHIFT;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "tile_occupancy.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LEVEL_CELL_SPAN (1 << TILE_OCCUPANCY_LEVEL_SHIFT)
+#define LEVEL_CELL_SPAN_MASK ((1u << LEVEL_CELL_SPAN) - 1)
+
+static size_t word_count(const STileOccupancyLevel * p_level)
+{
+  return (size_t)p_level->words_per_row * p_level->word_rows;
+}
+
+static void set_cell(STileOccupancyLevel * p_level, SVec2i cell, bool solid)
+{
+  uint64_t * const p_word = &p_level->p_words[tile_occupancy_level_word_index(p_level, cell)];
+  const uint64_t cell_bit = (uint64_t)1 << tile_occupancy_level_bit_index(p_level, cell);
+
+  if (solid)
+    *p_word |= cell_bit;
+  else
+    *p_word &= ~cell_bit;
+}
+
+// Whether any of the 8x8 cells of the finer level below a coarse cell is solid.
+// Tiled levels hold exactly these cells in one word. In row major levels the
+// cells of one row are 8 aligned, so they always sit in the same word
+static bool any_child_solid(const STileOccupancyLevel * p_child_level, SVec2i cell)
+{
+  const SVec2i first_child = { cell.x << TILE_OCCUPANCY_LEVEL_SHIFT, cell.y << TILE_OCCUPANCY_LEVEL_SHIFT };
+  if (p_child_level->layout == TILE_OCCUPANCY_LAYOUT_TILED)
+  {
+    return p_child_level->p_words[tile_occupancy_level_word_index(p_child_level, first_child)] != 0;
+  }
+
+  const int last_child_y = first_child.y + LEVEL_CELL_SPAN < p_child_level->cells_on_axis.y ?
+    first_child.y + LEVEL_CELL_SPAN : p_child_level->cells_on_axis.y;
+
+  for (int child_y = first_child.y; child_y < last_child_y; child_y++)
+  {
+    const uint64_t word = p_child_level->p_words[(size_t)child_y * p_child_level->words_per_row + (first_child.x >> 6)];
+    if ((word >> (first_child.x & 63)) & LEVEL_CELL_SPAN_MASK) return true;
+  }
+
+  return false;
+}
+
+bool tile_occupancy_create(STileOccupancy * p_occupancy, SVec2i tiles_on_axis)
+{
+  return tile_occupancy_create_with_layout(p_occupancy, tiles_on_axis, TILE_OCCUPANCY_LAYOUT_TILED);
+}
+
+bool tile_occupancy_create_with_layout(STileOccupancy * p_occupancy, SVec2i tiles_on_axis, ETileOccupancyLayoutType layout)
+{
+  *p_occupancy = (STileOccupancy) { tiles_on_axis, { { { 0, 0 }, TILE_OCCUPANCY_LAYOUT_ROW_MAJOR, 0, 0, NULL } }, 0, NULL };
+
+  SVec2i cells_on_axis = tiles_on_axis;
+  for (int level = 0; level < TILE_OCCUPANCY_LEVELS; level++)
+  {
+    STileOccupancyLevel * const p_level = &p_occupancy->levels[level];
+
+    p_level->cells_on_axis = cells_on_axis;
+    p_level->layout = level == 0 ? layout : TILE_OCCUPANCY_LAYOUT_ROW_MAJOR;
+    p_level->words_per_row = p_level->layout == TILE_OCCUPANCY_LAYOUT_TILED ? (cells_on_axis.x + 7) / 8 : (cells_on_axis.x + 63) / 64;
+    p_level->word_rows = p_level->layout == TILE_OCCUPANCY_LAYOUT_TILED ? (cells_on_axis.y + 7) / 8 : cells_on_axis.y;
+    PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+    p_level->p_words = calloc(word_count(p_level) > 0 ? word_count(p_level) : 1, sizeof(uint64_t));
+
+    if (p_level->p_words == NULL)
+    {
+      tile_occupancy_destroy(p_occupancy);
+      return false;
+    }
+
+    cells_on_axis = (SVec2i) {
+      (cells_on_axis.x + LEVEL_CELL_SPAN - 1) >> TILE_OCCUPANCY_LEVEL_SHIFT,
+      (cells_on_axis.y + LEVEL_CELL_SPAN - 1) >> TILE_OCCUPANCY_LEVEL_SHIFT
+    };
+  }
+
+  const SVec2i blocks_on_axis = p_occupancy->levels[TILE_OCCUPANCY_LEVELS - 1].cells_on_axis;
+  const size_t block_count = (size_t)blocks_on_axis.x * blocks_on_axis.y;
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  p_occupancy->p_block_versions = calloc(block_count > 0 ? block_count : 1, sizeof(uint32_t));
+
+  if (p_occupancy->p_block_versions == NULL)
+  {
+    tile_occupancy_destroy(p_occupancy);
+    return false;
+  }
+
+  return true;
+}
+
+void tile_occupancy_destroy(STileOccupancy * p_occupancy)
+{
+  for (int level = 0; level < TILE_OCCUPANCY_LEVELS; level++) free(p_occupancy->levels[level].p_words);
+  free(p_occupancy->p_block_versions);
+
+  *p_occupancy = (STileOccupancy) { { 0, 0 }, { { { 0, 0 }, TILE_OCCUPANCY_LAYOUT_ROW_MAJOR, 0, 0, NULL } }, 0, NULL };
+}
+
+void tile_occupancy_clear(STileOccupancy * p_occupancy)
+{
+  for (int level = 0; level < TILE_OCCUPANCY_LEVELS; level++)
+  {
+    memset(p_occupancy->levels[level].p_words, 0, sizeof(uint64_t) * word_count(&p_occupancy->levels[level]));
+  }
+
+  // Clearing may change any block
+  const SVec2i blocks_on_axis = p_occupancy->levels[TILE_OCCUPANCY_LEVELS - 1].cells_on_axis;
+  for (size_t block = 0; block < (size_t)blocks_on_axis.x * blocks_on_axis.y; block++) p_occupancy->p_block_versions[block]++;
+  p_occupancy->version++;
+}
+
+void tile_occupancy_set(STileOccupancy * p_occupancy, SVec2i tile, bool solid)
+{
+  if (tile.x < 0 || tile.x >= p_occupancy->tiles_on_axis.x || tile.y < 0 || tile.y >= p_occupancy->tiles_on_axis.y) return;
+  if (tile_occupancy_level_solid(&p_occupancy->levels[0], tile) == solid) return;
+
+  set_cell(&p_occupancy->levels[0], tile, solid);
+  p_occupancy->p_block_versions[tile_occupancy_version_block_index(p_occupancy, tile)]++;
+  p_occupancy->version++;
+
+  // A solid tile makes every block above it solid, an emptied tile only empties the
+  // blocks that have no other solid cell left below them
+  SVec2i cell = tile;
+  for (int level = 1; level < TILE_OCCUPANCY_LEVELS; level++)
+  {
+    cell = (SVec2i) { cell.x >> TILE_OCCUPANCY_LEVEL_SHIFT, cell.y >> TILE_OCCUPANCY_LEVEL_SHIFT };
+
+    const bool cell_solid = solid || any_child_solid(&p_occupancy->levels[level - 1], cell);
+    set_cell(&p_occupancy->levels[level], cell, cell_solid);
+  }
+}
@@ -0,0 +1,136 @@
+#ifndef TILE_OCCUPANCY_H
+#define TILE_OCCUPANCY_H
+
+#include "datatypes.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tiles, 8x8 tile blocks and 64x64 tile blocks
+#define TILE_OCCUPANCY_LEVELS 3
+
+// Every level has one cell per 8x8 cells of the level below
+#define TILE_OCCUPANCY_LEVEL_SHIFT 3
+
+// Row major levels pack 64 cells of a row into a word. Tiled levels pack an 8x8
+// block of cells into a word, so rays in any direction cross a new word only every
+// few cells rather than on every row, which keeps steep and diagonal rays in cache
+typedef enum
+{
+  TILE_OCCUPANCY_LAYOUT_ROW_MAJOR,
+  TILE_OCCUPANCY_LAYOUT_TILED
+} ETileOccupancyLayoutType;
+
+// Packed solid flags, one bit per cell. Rows of words start on a fresh word, so a
+// cell is found with shifts and masks and never straddles two words
+typedef struct
+{
+  SVec2i cells_on_axis;
+  ETileOccupancyLayoutType layout;
+  int words_per_row;
+  int word_rows;
+  uint64_t * p_words;
+} STileOccupancyLevel;
+
+// Solid tiles and a pyramid of coarser levels on top. A coarse cell is solid when
+// any tile it covers is, so rays can leap across empty blocks of tiles at once.
+// The coarse levels are kept up to date on every change of a tile. The layout
+// applies to the tiles, the small coarse levels are always row major.
+//
+// Every change of a tile counts up the version of the occupancy and of the 64x64
+// tile block holding the tile, one block per cell of the coarsest level, so results
+// computed from a few blocks can tell whether they are still current
+typedef struct
+{
+  SVec2i tiles_on_axis;
+  STileOccupancyLevel levels[TILE_OCCUPANCY_LEVELS];
+  uint64_t version;
+  uint32_t * p_block_versions;
+} STileOccupancy;
+
+// All tiles start out empty, in the tiled layout
+bool tile_occupancy_create(STileOccupancy * p_occupancy, SVec2i tiles_on_axis);
+bool tile_occupancy_create_with_layout(STileOccupancy * p_occupancy, SVec2i tiles_on_axis, ETileOccupancyLayoutType layout);
+void tile_occupancy_destroy(STileOccupancy * p_occupancy);
+void tile_occupancy_clear(STileOccupancy * p_occupancy);
+
+// Tiles outside of the occupancy are ignored, as are tiles already in that state
+void tile_occupancy_set(STileOccupancy * p_occupancy, SVec2i tile, bool solid);
+
+static inline size_t tile_occupancy_level_word_index(const STileOccupancyLevel * p_level, SVec2i cell)
+{
+  if (p_level->layout == TILE_OCCUPANCY_LAYOUT_TILED) return (size_t)(cell.y >> 3) * p_level->words_per_row + (cell.x >> 3);
+
+  return (size_t)cell.y * p_level->words_per_row + (cell.x >> 6);
+}
+
+static inline int tile_occupancy_level_bit_index(const STileOccupancyLevel * p_level, SVec2i cell)
+{
+  if (p_level->layout == TILE_OCCUPANCY_LAYOUT_TILED) return ((cell.y & 7) << 3) | (cell.x & 7);
+
+  return cell.x & 63;
+}
+
+static inline bool tile_occupancy_level_solid(const STileOccupancyLevel * p_level, SVec2i cell)
+{
+  const uint64_t word = p_level->p_words[tile_occupancy_level_word_index(p_level, cell)];
+  return (word >> tile_occupancy_level_bit_index(p_level, cell)) & 1;
+}
+
+// Tiles outside of the occupancy are empty
+static inline bool tile_occupancy_solid(const STileOccupancy * p_occupancy, SVec2i tile)
+{
+  if (tile.x < 0 || tile.x >= p_occupancy->tiles_on_axis.x || tile.y < 0 || tile.y >= p_occupancy->tiles_on_axis.y) return false;
+
+  return tile_occupancy_level_solid(&p_occupancy->levels[0], tile);
+}
+
+// Whether the occupancy holds the tiles of the grid, queries against any other
+// grid would index tiles the occupancy does not have
+static inline bool tile_occupancy_matches_grid(const STileOccupancy * p_occupancy, const SGrid * p_grid)
+{
+  return p_occupancy->tiles_on_axis.x == p_grid->tiles_on_axis.x && p_occupancy->tiles_on_axis.y == p_grid->tiles_on_axis.y;
+}
+
+// Shift from tiles to the 64x64 tile blocks versioned on their own
+#define TILE_OCCUPANCY_VERSION_BLOCK_SHIFT ((TILE_OCCUPANCY_LEVELS - 1) * TILE_OCCUPANCY_LEVEL_SHIFT)
+
+// Index into the block versions of the block holding a tile inside the occupancy
+static inline size_t tile_occupancy_version_block_index(const STileOccupancy * p_occupancy, SVec2i tile)
+{
+  const STileOccupancyLevel * const p_block_level = &p_occupancy->levels[TILE_OCCUPANCY_LEVELS - 1];
+  return
+    (size_t)(tile.y >> TILE_OCCUPANCY_VERSION_BLOCK_SHIFT) * p_block_level->cells_on_axis.x +
+    (tile.x >> TILE_OCCUPANCY_VERSION_BLOCK_SHIFT);
+}
+
+// Tile shift of the largest empty block around a tile, zero when even its 8x8 block
+// holds a solid tile. Tiles outside of the occupancy are empty, but only blocks
+// lying wholly outside are leapt, as a block reaching back inside may hold solid tiles
+static inline int tile_occupancy_empty_block_shift(const STileOccupancy * p_occupancy, SVec2i tile)
+{
+  if (tile.x < 0 || tile.x >= p_occupancy->tiles_on_axis.x || tile.y < 0 || tile.y >= p_occupancy->tiles_on_axis.y)
+  {
+    for (int shift = (TILE_OCCUPANCY_LEVELS - 1) * TILE_OCCUPANCY_LEVEL_SHIFT; shift > 0; shift -= TILE_OCCUPANCY_LEVEL_SHIFT)
+    {
+      const int block_size = 1 << shift;
+      const SVec2i block_min = { tile.x & -block_size, tile.y & -block_size };
+      const bool block_outside =
+        block_min.x + block_size <= 0 || block_min.x >= p_occupancy->tiles_on_axis.x ||
+        block_min.y + block_size <= 0 || block_min.y >= p_occupancy->tiles_on_axis.y;
+      if (block_outside) return shift;
+    }
+
+    return 0;
+  }
+
+  for (int level = TILE_OCCUPANCY_LEVELS - 1; level > 0; level--)
+  {
+    const int shift = level * TILE_OCCUPANCY_LEVEL_SHIFT;
+    if (!tile_occupancy_level_solid(&p_occupancy->levels[level], (SVec2i) { tile.x >> shift, tile.y >> shift })) return shift;
+  }
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "triple_buffer.h"
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The shared slot index carries this flag while it holds a snapshot the consumer
+// has not picked up yet
+#define SLOT_FRESH 4u
+#define SLOT_INDEX_MASK 3u
+
+// Slots start on their own cache lines, so the threads never share one
+#define SLOT_ALIGNMENT 64
+
+static size_t slot_stride(size_t slot_size)
+{
+  return (slot_size + (SLOT_ALIGNMENT - 1)) & ~(size_t)(SLOT_ALIGNMENT - 1);
+}
+
+bool triple_buffer_create(STripleBuffer * p_buffer, size_t slot_size)
+{
+  *p_buffer = (STripleBuffer) { .slot_size = slot_size, .shared_slot = 1, .write_slot = 0, .read_slot = 2 };
+  if (slot_size == 0) return false;
+
+  void * p_slots = NULL;
+  PROFILE_COUNT(PROFILE_COUNTER_ALLOCATIONS, 1);
+  if (posix_memalign(&p_slots, SLOT_ALIGNMENT, slot_stride(slot_size) * 3) != 0) return false;
+
+  p_buffer->p_slots = p_slots;
+  memset(p_buffer->p_slots, 0, slot_stride(slot_size) * 3);
+  return true;
+}
+
+void triple_buffer_destroy(STripleBuffer * p_buffer)
+{
+  free(p_buffer->p_slots);
+  p_buffer->p_slots = NULL;
+}
+
+void * triple_buffer_write_slot(STripleBuffer * p_buffer)
+{
+  return p_buffer->p_slots + slot_stride(p_buffer->slot_size) * p_buffer->write_slot;
+}
+
+void triple_buffer_publish(STripleBuffer * p_buffer)
+{
+  // Release the filled slot and take over whichever slot sat in between
+  const unsigned previous_shared = __atomic_exchange_n(&p_buffer->shared_slot, p_buffer->write_slot | SLOT_FRESH, __ATOMIC_ACQ_REL);
+  p_buffer->write_slot = previous_shared & SLOT_INDEX_MASK;
+}
+
+bool triple_buffer_acquire(STripleBuffer * p_buffer)
+{
+  if ((__atomic_load_n(&p_buffer->shared_slot, __ATOMIC_RELAXED) & SLOT_FRESH) == 0) return false;
+
+  // Only the consumer clears the flag, so the exchange always picks up a fresh slot
+  const unsigned previous_shared = __atomic_exchange_n(&p_buffer->shared_slot, p_buffer->read_slot, __ATOMIC_ACQ_REL);
+  p_buffer->read_slot = previous_shared & SLOT_INDEX_MASK;
+  return true;
+}
+
+const void * triple_buffer_read_slot(const STripleBuffer * p_buffer)
+{
+  return p_buffer->p_slots + slot_stride(p_buffer->slot_size) * p_buffer->read_slot;
+}
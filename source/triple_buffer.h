@@ -0,0 +1,39 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Hands snapshots from one producer thread to one consumer thread without locks
+// and without either side ever waiting. The producer fills its own slot and
+// publishes it, the consumer picks up the latest published slot, and the third
+// slot sits in between. Snapshots the consumer was too slow for are overwritten,
+// so it always sees the newest one. Producer and consumer state live on their own
+// cache lines, the buffer must not move between create and destroy
+typedef struct
+{
+  unsigned char * p_slots;
+  size_t slot_size;
+  unsigned shared_slot;
+  unsigned char shared_padding[60];
+  unsigned write_slot;
+  unsigned char write_padding[60];
+  unsigned read_slot;
+  unsigned char read_padding[60];
+} STripleBuffer;
+
+// Every slot starts out zeroed and the read slot counts as consumed
+bool triple_buffer_create(STripleBuffer * p_buffer, size_t slot_size);
+void triple_buffer_destroy(STripleBuffer * p_buffer);
+
+// Producer side - Fill the write slot, then publish it. The write slot changes on
+// every publish, so fetch it again afterwards
+void * triple_buffer_write_slot(STripleBuffer * p_buffer);
+void triple_buffer_publish(STripleBuffer * p_buffer);
+
+// Consumer side - Moves to the latest published snapshot. Returns false and keeps
+// the current read slot when nothing was published since the last acquire
+bool triple_buffer_acquire(STripleBuffer * p_buffer);
+const void * triple_buffer_read_slot(const STripleBuffer * p_buffer);
+
+#endif